@@ -0,0 +1,48 @@
+#ifndef _DHTLOG_H_
+#define _DHTLOG_H_
+
+#include <omnetpp.h>
+
+/* verbosity levels of the protocol log: INFO reports protocol milestones
+ * (joins, estimates, long links created), TRACE every single packet handled
+ */
+#define DHT_LOG_OFF   0
+#define DHT_LOG_INFO  1
+#define DHT_LOG_TRACE 2
+
+/* highest level compiled in, messages above it are removed by the compiler.
+ * Build batch binaries with -DDHT_LOG_LEVEL=0 (e.g. opp_makemake ... -DDHT_LOG_LEVEL=0)
+ * to drop the whole protocol log
+ */
+#ifndef DHT_LOG_LEVEL
+#define DHT_LOG_LEVEL DHT_LOG_TRACE
+#endif
+
+/* streams into EV only if level is compiled in, enabled by the logLevel member of the
+ * module using it and the environment is collecting output. Nothing at the right of the
+ * macro is evaluated otherwise, so filtered messages cost a comparison and no formatting.
+ * The dangling else makes it safe to use as the body of an unbraced if
+ */
+#define DHT_LOG(level) \
+    if ((level) > DHT_LOG_LEVEL || (level) > logLevel || ev.isDisabled()) ; else EV
+
+#define DHT_INFO  DHT_LOG(DHT_LOG_INFO)
+#define DHT_TRACE DHT_LOG(DHT_LOG_TRACE)
+
+/* converts the logLevel module parameter to one of the levels above. "auto" means full
+ * trace under a graphical environment and no log at all in batch (Cmdenv) runs
+ */
+inline int parseDHTLogLevel(const char* level) {
+    if (strcmp(level, "auto") == 0)
+        return ev.isGUI() ? DHT_LOG_TRACE : DHT_LOG_OFF;
+    if (strcmp(level, "off") == 0)
+        return DHT_LOG_OFF;
+    if (strcmp(level, "info") == 0)
+        return DHT_LOG_INFO;
+    if (strcmp(level, "trace") == 0)
+        return DHT_LOG_TRACE;
+
+    throw cRuntimeError("unknown log level \"%s\", expected auto, off, info or trace", level);
+}
+
+#endif // _DHTLOG_H_
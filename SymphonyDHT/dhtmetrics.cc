@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include "dhtmetrics.h"
+
+long DHTMetrics::networkPacketsSent[OPCODES_NUMBER];
+long DHTMetrics::networkPacketsSentTotal = 0;
+long DHTMetrics::networkBytesSent = 0;
+long DHTMetrics::networkLookups[LOOKUP_PROTOCOLS_NUMBER];
+long DHTMetrics::networkKeysHandedOff = 0;
+long DHTMetrics::networkManagerCacheHits = 0;
+long DHTMetrics::networkLookupsRejected[LOOKUP_PROTOCOLS_NUMBER];
+long DHTMetrics::networkStorageOperationsThrottled = 0;
+long DHTMetrics::networkLookupsFailed[LOOKUP_PROTOCOLS_NUMBER];
+long DHTMetrics::networkPacketsLost = 0;
+long DHTMetrics::networkPacketsDropped = 0;
+long DHTMetrics::networkDepartures = 0;
+long DHTMetrics::networkRepairPacketsSent = 0;
+long DHTMetrics::networkRepairs = 0;
+long DHTMetrics::networkRelinks = 0;
+long DHTMetrics::networkRelinkLinksKept = 0;
+double DHTMetrics::networkRepairTimeSum = 0;
+double DHTMetrics::networkRepairTimeMax = 0;
+long DHTMetrics::nextLookupId = 0;
+
+/* protocol phase of every opcode, indexed by the message kind.
+ * Entries must follow the order of enum Opcode in packet.msg
+ */
+const int DHTMetrics::phaseOfOpcode[OPCODES_NUMBER] = {
+    PHASE_ESTIMATION,   /* SEGMENT_LENGTH_REQUEST */
+    PHASE_ESTIMATION,   /* SEGMENT_LENGTH_REPLY */
+    PHASE_ESTIMATION,   /* ESTIMATE_UPDATE */
+    PHASE_LOOKUP,       /* MANAGER_CHECK */
+    PHASE_LOOKUP,       /* MANAGER_QUERY */
+    PHASE_LOOKUP,       /* MANAGER_INDEX */
+    PHASE_MEMBERSHIP,   /* JOIN_NETWORK */
+    PHASE_MEMBERSHIP,   /* LEAVE_NETWORK */
+    PHASE_LOOKUP,       /* RELINK_REQUEST */
+    PHASE_LOOKUP        /* LOOKUP_TIMEOUT */
+};
+
+/* signal names are <phase>PacketSent, see package.ned */
+const char* DHTMetrics::phaseNames[PHASES_NUMBER] = {
+    "estimation",
+    "lookup",
+    "membership"
+};
+
+/* signal names are <protocol>LookupHops and <protocol>LookupLatency, see package.ned */
+const char* DHTMetrics::lookupProtocolNames[LOOKUP_PROTOCOLS_NUMBER] = {
+    "relink",
+    "join",
+    "put",
+    "get",
+    "repair"
+};
+
+simsignal_t DHTMetrics::packetSentSignal;
+simsignal_t DHTMetrics::packetBytesSignal;
+simsignal_t DHTMetrics::phasePacketSentSignals[PHASES_NUMBER];
+simsignal_t DHTMetrics::lookupHopsSignal;
+simsignal_t DHTMetrics::lookupLatencySignal;
+simsignal_t DHTMetrics::protocolLookupHopsSignals[LOOKUP_PROTOCOLS_NUMBER];
+simsignal_t DHTMetrics::protocolLookupLatencySignals[LOOKUP_PROTOCOLS_NUMBER];
+simsignal_t DHTMetrics::getHitSignal;
+simsignal_t DHTMetrics::storageRequestManagedSignal;
+simsignal_t DHTMetrics::lookupsInTransitSignal;
+simsignal_t DHTMetrics::managerCacheHitSignal;
+simsignal_t DHTMetrics::queueLengthSignal;
+simsignal_t DHTMetrics::queueingTimeSignal;
+simsignal_t DHTMetrics::lookupRejectedSignal;
+simsignal_t DHTMetrics::pathStretchSignal;
+simsignal_t DHTMetrics::lookupFailedSignal;
+simsignal_t DHTMetrics::repairTimeSignal;
+simsignal_t DHTMetrics::longLinksSignal;
+simsignal_t DHTMetrics::relinkLinksKeptSignal;
+
+DHTMetrics::DHTMetrics() {
+    owner = NULL;
+}
+
+/* binds the metrics to the module emitting them and clears its counters */
+void DHTMetrics::initialize(cModule* owner) {
+    int i;
+    char signalName[32];
+
+    this->owner = owner;
+    for (i=0; i<OPCODES_NUMBER; i++)
+        packetsSent[i] = 0;
+    bytesSent = 0;
+    keysHandedOff = 0;
+    storageRequestsManaged = 0;
+    lookupsInTransit = 0;
+
+    packetSentSignal = cComponent::registerSignal("packetSent");
+    packetBytesSignal = cComponent::registerSignal("packetBytes");
+    for (i=0; i<PHASES_NUMBER; i++) {
+        sprintf(signalName, "%sPacketSent", phaseNames[i]);
+        phasePacketSentSignals[i] = cComponent::registerSignal(signalName);
+    }
+    lookupHopsSignal = cComponent::registerSignal("lookupHops");
+    lookupLatencySignal = cComponent::registerSignal("lookupLatency");
+    for (i=0; i<LOOKUP_PROTOCOLS_NUMBER; i++) {
+        sprintf(signalName, "%sLookupHops", lookupProtocolNames[i]);
+        protocolLookupHopsSignals[i] = cComponent::registerSignal(signalName);
+        sprintf(signalName, "%sLookupLatency", lookupProtocolNames[i]);
+        protocolLookupLatencySignals[i] = cComponent::registerSignal(signalName);
+    }
+    getHitSignal = cComponent::registerSignal("getHit");
+    storageRequestManagedSignal = cComponent::registerSignal("storageRequestManaged");
+    lookupsInTransitSignal = cComponent::registerSignal("lookupsInTransit");
+    managerCacheHitSignal = cComponent::registerSignal("managerCacheHit");
+    queueLengthSignal = cComponent::registerSignal("queueLength");
+    queueingTimeSignal = cComponent::registerSignal("queueingTime");
+    lookupRejectedSignal = cComponent::registerSignal("lookupRejected");
+    pathStretchSignal = cComponent::registerSignal("pathStretch");
+    lookupFailedSignal = cComponent::registerSignal("lookupFailed");
+    repairTimeSignal = cComponent::registerSignal("repairTime");
+    longLinksSignal = cComponent::registerSignal("longLinks");
+    relinkLinksKeptSignal = cComponent::registerSignal("relinkLinksKept");
+}
+
+/* clears the counters shared by the whole network */
+void DHTMetrics::resetNetwork() {
+    int i;
+    for (i=0; i<OPCODES_NUMBER; i++)
+        networkPacketsSent[i] = 0;
+    networkPacketsSentTotal = 0;
+    networkBytesSent = 0;
+    for (i=0; i<LOOKUP_PROTOCOLS_NUMBER; i++) {
+        networkLookups[i] = 0;
+        networkLookupsRejected[i] = 0;
+        networkLookupsFailed[i] = 0;
+    }
+    networkKeysHandedOff = 0;
+    networkManagerCacheHits = 0;
+    networkStorageOperationsThrottled = 0;
+    networkPacketsLost = 0;
+    networkPacketsDropped = 0;
+    networkDepartures = 0;
+    networkRepairPacketsSent = 0;
+    networkRepairs = 0;
+    networkRelinks = 0;
+    networkRelinkLinksKept = 0;
+    networkRepairTimeSum = 0;
+    networkRepairTimeMax = 0;
+    nextLookupId = 0;
+}
+
+void DHTMetrics::packetSent(Packet* packet) {
+    int opcode = packet->getKind();
+
+    packetsSent[opcode]++;
+    networkPacketsSent[opcode]++;
+    networkPacketsSentTotal++;
+    bytesSent += packet->getByteLength();
+    networkBytesSent += packet->getByteLength();
+    if (packet->getProtocol() == LOOKUP_PROTOCOL_REPAIR)
+        networkRepairPacketsSent++;
+
+    owner->emit(packetSentSignal, (long)opcode);
+    owner->emit(phasePacketSentSignals[phaseOfOpcode[opcode]], (long)opcode);
+    if (owner->mayHaveListeners(packetBytesSignal))
+        owner->emit(packetBytesSignal, (long)packet->getByteLength());
+}
+
+long DHTMetrics::newLookupId() {
+    return nextLookupId++;
+}
+
+void DHTMetrics::lookupCompleted(int protocol, Packet* reply) {
+    simtime_t latency = simTime() - reply->getLookupStart();
+
+    networkLookups[protocol]++;
+    owner->emit(lookupHopsSignal, (long)reply->getLookupHops());
+    owner->emit(lookupLatencySignal, latency);
+    owner->emit(protocolLookupHopsSignals[protocol], (long)reply->getLookupHops());
+    owner->emit(protocolLookupLatencySignals[protocol], latency);
+}
+
+const char* DHTMetrics::getLookupProtocolName(int protocol) {
+    return lookupProtocolNames[protocol];
+}
+
+void DHTMetrics::getCompleted(bool found) {
+    owner->emit(getHitSignal, found ? 1L : 0L);
+}
+
+void DHTMetrics::keysMoved(long keys) {
+    keysHandedOff += keys;
+    networkKeysHandedOff += keys;
+}
+
+void DHTMetrics::storageRequestManaged() {
+    storageRequestsManaged++;
+    owner->emit(storageRequestManagedSignal, storageRequestsManaged);
+}
+
+void DHTMetrics::lookupForwarded() {
+    lookupsInTransit++;
+    owner->emit(lookupsInTransitSignal, lookupsInTransit);
+}
+
+void DHTMetrics::lookupReturned() {
+    lookupsInTransit--;
+    owner->emit(lookupsInTransitSignal, lookupsInTransit);
+}
+
+void DHTMetrics::managerCacheLookup(bool hit) {
+    if (hit)
+        networkManagerCacheHits++;
+    owner->emit(managerCacheHitSignal, hit ? 1L : 0L);
+}
+
+void DHTMetrics::queueLengthChanged(long length) {
+    owner->emit(queueLengthSignal, length);
+}
+
+void DHTMetrics::serviceStarted(simtime_t queueingTime) {
+    owner->emit(queueingTimeSignal, queueingTime);
+}
+
+void DHTMetrics::lookupRejected(int protocol) {
+    networkLookupsRejected[protocol]++;
+    owner->emit(lookupRejectedSignal, (long)protocol);
+}
+
+void DHTMetrics::storageOperationThrottled() {
+    networkStorageOperationsThrottled++;
+}
+
+void DHTMetrics::pathStretchMeasured(double stretch) {
+    owner->emit(pathStretchSignal, stretch);
+}
+
+void DHTMetrics::lookupFailed(int protocol) {
+    networkLookupsFailed[protocol]++;
+    owner->emit(lookupFailedSignal, (long)protocol);
+}
+
+void DHTMetrics::packetLost() {
+    networkPacketsLost++;
+}
+
+void DHTMetrics::packetDropped() {
+    networkPacketsDropped++;
+}
+
+void DHTMetrics::memberLeft() {
+    networkDepartures++;
+}
+
+void DHTMetrics::repairCompleted(simtime_t time) {
+    networkRepairs++;
+    networkRepairTimeSum += SIMTIME_DBL(time);
+    if (SIMTIME_DBL(time) > networkRepairTimeMax)
+        networkRepairTimeMax = SIMTIME_DBL(time);
+    owner->emit(repairTimeSignal, time);
+}
+
+void DHTMetrics::longLinksChanged(long longLinks) {
+    owner->emit(longLinksSignal, longLinks);
+}
+
+void DHTMetrics::relinkStarted(long linksKept) {
+    networkRelinks++;
+    networkRelinkLinksKept += linksKept;
+    owner->emit(relinkLinksKeptSignal, linksKept);
+}
+
+/* total number of packets sent by the owner */
+long DHTMetrics::getPacketsSent() const {
+    int i;
+    long total = 0;
+    for (i=0; i<OPCODES_NUMBER; i++)
+        total += packetsSent[i];
+    return total;
+}
+
+const char* DHTMetrics::getOpcodeName(int opcode) {
+    cEnum* opcodes = cEnum::find("Opcode");
+    const char* name = opcodes != NULL ? opcodes->getStringFor(opcode) : NULL;
+    return name != NULL ? name : "UNKNOWN";
+}
+
+/* records per-opcode counters of the owner as scalars */
+void DHTMetrics::record() {
+    int i;
+    char scalarName[64];
+
+    for (i=0; i<OPCODES_NUMBER; i++) {
+        if (packetsSent[i] == 0)
+            continue;
+        sprintf(scalarName, "#packetsSent:%s", getOpcodeName(i));
+        owner->recordScalar(scalarName, packetsSent[i]);
+    }
+    owner->recordScalar("#bytesSent", bytesSent, "B");
+    if (keysHandedOff > 0)
+        owner->recordScalar("#keysHandedOff", keysHandedOff);
+}
+
+/* records counters of the whole network as scalars of the module taken in input */
+void DHTMetrics::recordNetwork(cModule* recorder) {
+    int i;
+    char scalarName[64];
+    long phasePacketsSent[PHASES_NUMBER];
+    long attempts;
+    long totalAttempts = 0;
+    long totalFailed = 0;
+
+    for (i=0; i<PHASES_NUMBER; i++)
+        phasePacketsSent[i] = 0;
+
+    for (i=0; i<OPCODES_NUMBER; i++) {
+        phasePacketsSent[phaseOfOpcode[i]] += networkPacketsSent[i];
+        sprintf(scalarName, "#networkPacketsSent:%s", getOpcodeName(i));
+        recorder->recordScalar(scalarName, networkPacketsSent[i]);
+    }
+    for (i=0; i<PHASES_NUMBER; i++) {
+        sprintf(scalarName, "#networkPacketsSent:%s", phaseNames[i]);
+        recorder->recordScalar(scalarName, phasePacketsSent[i]);
+    }
+    recorder->recordScalar("#networkPacketsSent", getNetworkPacketsSent());
+    recorder->recordScalar("#networkBytesSent", networkBytesSent, "B");
+    for (i=0; i<LOOKUP_PROTOCOLS_NUMBER; i++) {
+        sprintf(scalarName, "#networkLookups:%s", lookupProtocolNames[i]);
+        recorder->recordScalar(scalarName, networkLookups[i]);
+        sprintf(scalarName, "#networkLookupsRejected:%s", lookupProtocolNames[i]);
+        recorder->recordScalar(scalarName, networkLookupsRejected[i]);
+        if (simTime() > 0) {
+            sprintf(scalarName, "#networkLookupThroughput:%s", lookupProtocolNames[i]);
+            recorder->recordScalar(scalarName, networkLookups[i] / SIMTIME_DBL(simTime()), "1/s");
+        }
+
+        /* failed lookups are the ones given up after lookupTimeout */
+        sprintf(scalarName, "#networkLookupsFailed:%s", lookupProtocolNames[i]);
+        recorder->recordScalar(scalarName, networkLookupsFailed[i]);
+        attempts = networkLookups[i] + networkLookupsRejected[i] + networkLookupsFailed[i];
+        if (attempts > 0) {
+            sprintf(scalarName, "#networkLookupFailureRate:%s", lookupProtocolNames[i]);
+            recorder->recordScalar(scalarName, (double)networkLookupsFailed[i] / attempts);
+        }
+        totalAttempts += attempts;
+        totalFailed += networkLookupsFailed[i];
+    }
+    if (totalAttempts > 0)
+        recorder->recordScalar("#networkLookupFailureRate", (double)totalFailed / totalAttempts);
+    recorder->recordScalar("#networkKeysHandedOff", networkKeysHandedOff);
+    recorder->recordScalar("#networkManagerCacheHits", networkManagerCacheHits);
+    recorder->recordScalar("#networkStorageOperationsThrottled", networkStorageOperationsThrottled);
+
+    /* maintenance traffic under churn: relink requests and repair lookups sent
+     * because of departures, and the time taken to look up lost long links again
+     */
+    recorder->recordScalar("#networkPacketsLost", networkPacketsLost);
+    recorder->recordScalar("#networkPacketsDropped", networkPacketsDropped);
+    recorder->recordScalar("#networkDepartures", networkDepartures);
+    recorder->recordScalar("#networkRepairPacketsSent", networkRepairPacketsSent);
+    if (networkDepartures > 0)
+        recorder->recordScalar("#networkRepairPacketsPerDeparture", (double)networkRepairPacketsSent / networkDepartures);
+    recorder->recordScalar("#networkRepairs", networkRepairs);
+    if (networkRepairs > 0) {
+        recorder->recordScalar("#networkRepairTimeMean", networkRepairTimeSum / networkRepairs, "s");
+        recorder->recordScalar("#networkRepairTimeMax", networkRepairTimeMax, "s");
+    }
+    recorder->recordScalar("#networkRelinks", networkRelinks);
+    recorder->recordScalar("#networkRelinkLinksKept", networkRelinkLinksKept);
+}
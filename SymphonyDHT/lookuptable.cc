@@ -0,0 +1,117 @@
+#include <string.h>
+#include "lookuptable.h"
+
+/* capacity must be a power of two, so that home indices are a mask away from hashes */
+LookupTable::LookupTable(unsigned int initialCapacity) {
+    capacity = 1;
+    while (capacity < initialCapacity)
+        capacity *= 2;
+
+    slots = new Slot[capacity];
+    count = 0;
+    clear();
+}
+
+LookupTable::~LookupTable() {
+    delete [] slots;
+}
+
+/* lookup IDs are consecutive integers, multiplicative hashing spreads them over the table */
+unsigned int LookupTable::getHomeIndex(long lookupId) const {
+    return ((unsigned long)lookupId * 2654435761UL) & (capacity - 1);
+}
+
+/* returns the index of the slot holding the lookup taken in input, -1 if it is not in the table */
+int LookupTable::getSlotIndex(long lookupId) const {
+    unsigned int i = getHomeIndex(lookupId);
+
+    while (slots[i].used) {
+        if (slots[i].state.lookupId == lookupId)
+            return i;
+        i = (i + 1) & (capacity - 1);
+    }
+
+    return -1;
+}
+
+LookupState* LookupTable::find(long lookupId) {
+    int i = getSlotIndex(lookupId);
+    return i >= 0 ? &slots[i].state : NULL;
+}
+
+LookupState* LookupTable::insert(long lookupId) {
+    unsigned int i;
+
+    if (2 * (count + 1) > capacity)
+        grow();
+
+    i = getHomeIndex(lookupId);
+    while (slots[i].used) {
+        if (slots[i].state.lookupId == lookupId)
+            return &slots[i].state;
+        i = (i + 1) & (capacity - 1);
+    }
+
+    slots[i].used = true;
+    memset(&slots[i].state, 0, sizeof(LookupState));
+    slots[i].state.lookupId = lookupId;
+    count++;
+    return &slots[i].state;
+}
+
+/* removes the lookup taken in input. Every entry of the probe sequence following the
+ * freed slot which could have been stored there is moved back into it
+ */
+void LookupTable::remove(long lookupId) {
+    int i;
+    unsigned int j;
+    unsigned int home;
+
+    i = getSlotIndex(lookupId);
+    if (i < 0)
+        return;
+
+    slots[i].used = false;
+    count--;
+
+    j = i;
+    while (true) {
+        j = (j + 1) & (capacity - 1);
+        if (!slots[j].used)
+            return;
+
+        /* entries which home lies cyclically in (i, j] are already where they should be */
+        home = getHomeIndex(slots[j].state.lookupId);
+        if ((unsigned int)i <= j ? ((unsigned int)i < home && home <= j) : ((unsigned int)i < home || home <= j))
+            continue;
+
+        slots[i] = slots[j];
+        slots[j].used = false;
+        i = j;
+    }
+}
+
+void LookupTable::clear() {
+    unsigned int i;
+    for (i=0; i<capacity; i++)
+        slots[i].used = false;
+    count = 0;
+}
+
+/* doubles the capacity of the table, inserting every entry again */
+void LookupTable::grow() {
+    unsigned int i;
+    unsigned int oldCapacity = capacity;
+    Slot* oldSlots = slots;
+
+    capacity *= 2;
+    slots = new Slot[capacity];
+    clear();
+
+    for (i=0; i<oldCapacity; i++) {
+        if (oldSlots[i].used)
+            *insert(oldSlots[i].state.lookupId) = oldSlots[i].state;
+    }
+
+    delete [] oldSlots;
+}
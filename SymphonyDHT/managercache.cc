@@ -0,0 +1,85 @@
+#include "managercache.h"
+
+ManagerCache::ManagerCache() {
+    capacity = 0;
+    timeout = 0;
+}
+
+void ManagerCache::configure(unsigned int capacity, simtime_t timeout) {
+    this->capacity = capacity;
+    this->timeout = timeout;
+    entries.clear();
+}
+
+/* returns true if p lies in the segment of the entry taken in input,
+ * segments wrap around 0 when from is not lower than to
+ */
+bool ManagerCache::contains(const Entry& entry, double p) {
+    if (entry.from < entry.to)
+        return p > entry.from && p <= entry.to;
+    return p > entry.from || p <= entry.to;
+}
+
+int ManagerCache::lookup(double point) {
+    unsigned int i;
+
+    for (i=0; i<entries.size(); i++) {
+        if (!contains(entries[i], point))
+            continue;
+
+        /* segments change with joins and leaves, old entries are not trusted */
+        if (simTime() - entries[i].learnedAt > timeout) {
+            entries.erase(entries.begin() + i);
+            return -1;
+        }
+        return entries[i].manager;
+    }
+
+    return -1;
+}
+
+void ManagerCache::insert(double from, double to, int manager) {
+    unsigned int i;
+    unsigned int oldest;
+    Entry entry;
+
+    if (capacity == 0)
+        return;
+
+    entry.from = from < 0 ? from + 1 : from;
+    entry.to = to;
+    entry.manager = manager;
+    entry.learnedAt = simTime();
+
+    /* the new segment is the latest news, segments it overlaps are out of date */
+    i = 0;
+    while (i < entries.size()) {
+        if (entries[i].manager == manager || contains(entries[i], entry.to) || contains(entry, entries[i].to))
+            entries.erase(entries.begin() + i);
+        else
+            i++;
+    }
+
+    if (entries.size() >= capacity) {
+        oldest = 0;
+        for (i=1; i<entries.size(); i++) {
+            if (entries[i].learnedAt < entries[oldest].learnedAt)
+                oldest = i;
+        }
+        entries.erase(entries.begin() + oldest);
+    }
+
+    entries.push_back(entry);
+}
+
+void ManagerCache::invalidate(double point) {
+    unsigned int i;
+
+    i = 0;
+    while (i < entries.size()) {
+        if (contains(entries[i], point))
+            entries.erase(entries.begin() + i);
+        else
+            i++;
+    }
+}
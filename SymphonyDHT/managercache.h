@@ -0,0 +1,45 @@
+#ifndef _MANAGERCACHE_H_
+#define _MANAGERCACHE_H_
+
+#include <omnetpp.h>
+#include <vector>
+
+/* bounded cache of the segments of recently discovered managers. Each entry maps the
+ * segment (x - segmentLength, x] a manager advertised in its answer to a lookup onto
+ * the index of that manager. Entries expire after a timeout, the oldest one is evicted
+ * when the cache is full and a new segment replaces every entry it overlaps
+ */
+class ManagerCache
+{
+  private:
+    struct Entry {
+        double from;
+        double to;
+        int manager;
+        simtime_t learnedAt;
+    };
+
+    std::vector<Entry> entries;
+    unsigned int capacity;
+    simtime_t timeout;
+
+    static bool contains(const Entry& entry, double p);
+
+  public:
+    ManagerCache();
+
+    /* a capacity of 0 disables the cache */
+    void configure(unsigned int capacity, simtime_t timeout);
+    bool isEnabled() const {return capacity > 0;}
+
+    /* returns the index of the cached manager of the point taken in input, -1 if none */
+    int lookup(double point);
+    /* caches the manager which segment is (from, to] going clockwise */
+    void insert(double from, double to, int manager);
+    /* drops every entry whose segment contains the point taken in input */
+    void invalidate(double point);
+    void clear() {entries.clear();}
+    unsigned int size() const {return entries.size();}
+};
+
+#endif // _MANAGERCACHE_H_
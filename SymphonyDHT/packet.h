@@ -0,0 +1,48 @@
+#ifndef _PACKET_H_
+#define _PACKET_H_
+
+#include "packet_m.h"
+
+/* number of routing hops a packet can remember without allocating memory,
+ * lookups need O(log^2(n) / K) hops so this covers networks far bigger than 512 nodes
+ */
+#define ROUTING_LIST_INLINE_SIZE 32
+
+/* protocol packet. Its routing list is a stack of the gate indices a lookup has to
+ * follow backwards to reach the node who made the request: every forwarding hop pushes
+ * one index, every backward hop pops one. Indices are stored inline and moved to the
+ * heap only when a lookup needs more than ROUTING_LIST_INLINE_SIZE hops
+ */
+class Packet : public Packet_Base
+{
+  private:
+    int routingListInline[ROUTING_LIST_INLINE_SIZE];
+    int* routingList;
+    unsigned int routingListSize;
+    unsigned int routingListCapacity;
+
+    void copy(const Packet& other);
+    void reserveRoutingList(unsigned int capacity);
+
+  public:
+    Packet(const char *name=NULL, int kind=0);
+    Packet(const Packet& other);
+    virtual ~Packet();
+    Packet& operator=(const Packet& other);
+    virtual Packet *dup() const {return new Packet(*this);}
+    virtual void parsimPack(cCommBuffer *b);
+    virtual void parsimUnpack(cCommBuffer *b);
+
+    /* routing list as a stack */
+    virtual void pushRoutingList(int gateIndex);
+    virtual int popRoutingList();
+    virtual void clearRoutingList() {routingListSize = 0;}
+
+    /* routing list as the array declared in packet.msg */
+    virtual void setRoutingListArraySize(unsigned int size);
+    virtual unsigned int getRoutingListArraySize() const {return routingListSize;}
+    virtual int getRoutingList(unsigned int k) const;
+    virtual void setRoutingList(unsigned int k, int routingList);
+};
+
+#endif // _PACKET_H_
@@ -29,33 +29,50 @@ void doUnpacking(cCommBuffer *, T& t) {
 
 
 
-
-Register_Class(Packet);
-
-Packet::Packet(const char *name, int kind) : cPacket(name,kind)
+EXECUTE_ON_STARTUP(
+    cEnum *e = cEnum::find("Opcode");
+    if (!e) enums.getInstance()->add(e = new cEnum("Opcode"));
+    e->insert(SEGMENT_LENGTH_REQUEST, "SEGMENT_LENGTH_REQUEST");
+    e->insert(SEGMENT_LENGTH_REPLY, "SEGMENT_LENGTH_REPLY");
+    e->insert(ESTIMATE_UPDATE, "ESTIMATE_UPDATE");
+    e->insert(MANAGER_CHECK, "MANAGER_CHECK");
+    e->insert(MANAGER_QUERY, "MANAGER_QUERY");
+    e->insert(MANAGER_INDEX, "MANAGER_INDEX");
+    e->insert(JOIN_NETWORK, "JOIN_NETWORK");
+    e->insert(LEAVE_NETWORK, "LEAVE_NETWORK");
+    e->insert(RELINK_REQUEST, "RELINK_REQUEST");
+    e->insert(LOOKUP_TIMEOUT, "LOOKUP_TIMEOUT");
+    e->insert(OPCODES_NUMBER, "OPCODES_NUMBER");
+);
+
+Packet_Base::Packet_Base(const char *name, int kind) : cPacket(name,kind)
 {
     this->x_var = 0;
     this->segmentLength_var = 0;
     this->nEstimate_var = 0;
-    this->toSenderGateIndex_var = 0;
-    routingList_arraysize = 0;
-    this->routingList_var = 0;
     this->manager_var = 0;
+    this->lookupId_var = 0;
+    this->lookupStart_var = 0;
+    this->lookupHops_var = 0;
+    this->protocol_var = 0;
+    this->key_var = 0;
+    this->value_var = 0;
+    this->found_var = 0;
+    this->managerX_var = 0;
+    this->managerSegmentLength_var = 0;
+    this->joiningMember_var = 0;
 }
 
-Packet::Packet(const Packet& other) : cPacket(other)
+Packet_Base::Packet_Base(const Packet_Base& other) : cPacket(other)
 {
-    routingList_arraysize = 0;
-    this->routingList_var = 0;
     copy(other);
 }
 
-Packet::~Packet()
+Packet_Base::~Packet_Base()
 {
-    delete [] routingList_var;
 }
 
-Packet& Packet::operator=(const Packet& other)
+Packet_Base& Packet_Base::operator=(const Packet_Base& other)
 {
     if (this==&other) return *this;
     cPacket::operator=(other);
@@ -63,135 +80,209 @@ Packet& Packet::operator=(const Packet& other)
     return *this;
 }
 
-void Packet::copy(const Packet& other)
+void Packet_Base::copy(const Packet_Base& other)
 {
     this->x_var = other.x_var;
     this->segmentLength_var = other.segmentLength_var;
     this->nEstimate_var = other.nEstimate_var;
-    this->toSenderGateIndex_var = other.toSenderGateIndex_var;
-    delete [] this->routingList_var;
-    this->routingList_var = (other.routingList_arraysize==0) ? NULL : new int[other.routingList_arraysize];
-    routingList_arraysize = other.routingList_arraysize;
-    for (unsigned int i=0; i<routingList_arraysize; i++)
-        this->routingList_var[i] = other.routingList_var[i];
     this->manager_var = other.manager_var;
+    this->lookupId_var = other.lookupId_var;
+    this->lookupStart_var = other.lookupStart_var;
+    this->lookupHops_var = other.lookupHops_var;
+    this->protocol_var = other.protocol_var;
+    this->key_var = other.key_var;
+    this->value_var = other.value_var;
+    this->found_var = other.found_var;
+    this->managerX_var = other.managerX_var;
+    this->managerSegmentLength_var = other.managerSegmentLength_var;
+    this->joiningMember_var = other.joiningMember_var;
 }
 
-void Packet::parsimPack(cCommBuffer *b)
+void Packet_Base::parsimPack(cCommBuffer *b)
 {
     cPacket::parsimPack(b);
     doPacking(b,this->x_var);
     doPacking(b,this->segmentLength_var);
     doPacking(b,this->nEstimate_var);
-    doPacking(b,this->toSenderGateIndex_var);
-    b->pack(routingList_arraysize);
-    doPacking(b,this->routingList_var,routingList_arraysize);
+    // field routingList is abstract -- please do packing in customized class
     doPacking(b,this->manager_var);
+    doPacking(b,this->lookupId_var);
+    doPacking(b,this->lookupStart_var);
+    doPacking(b,this->lookupHops_var);
+    doPacking(b,this->protocol_var);
+    doPacking(b,this->key_var);
+    doPacking(b,this->value_var);
+    doPacking(b,this->found_var);
+    doPacking(b,this->managerX_var);
+    doPacking(b,this->managerSegmentLength_var);
+    doPacking(b,this->joiningMember_var);
 }
 
-void Packet::parsimUnpack(cCommBuffer *b)
+void Packet_Base::parsimUnpack(cCommBuffer *b)
 {
     cPacket::parsimUnpack(b);
     doUnpacking(b,this->x_var);
     doUnpacking(b,this->segmentLength_var);
     doUnpacking(b,this->nEstimate_var);
-    doUnpacking(b,this->toSenderGateIndex_var);
-    delete [] this->routingList_var;
-    b->unpack(routingList_arraysize);
-    if (routingList_arraysize==0) {
-        this->routingList_var = 0;
-    } else {
-        this->routingList_var = new int[routingList_arraysize];
-        doUnpacking(b,this->routingList_var,routingList_arraysize);
-    }
+    // field routingList is abstract -- please do unpacking in customized class
     doUnpacking(b,this->manager_var);
+    doUnpacking(b,this->lookupId_var);
+    doUnpacking(b,this->lookupStart_var);
+    doUnpacking(b,this->lookupHops_var);
+    doUnpacking(b,this->protocol_var);
+    doUnpacking(b,this->key_var);
+    doUnpacking(b,this->value_var);
+    doUnpacking(b,this->found_var);
+    doUnpacking(b,this->managerX_var);
+    doUnpacking(b,this->managerSegmentLength_var);
+    doUnpacking(b,this->joiningMember_var);
 }
 
-double Packet::getX() const
+double Packet_Base::getX() const
 {
     return x_var;
 }
 
-void Packet::setX(double x)
+void Packet_Base::setX(double x)
 {
     this->x_var = x;
 }
 
-double Packet::getSegmentLength() const
+double Packet_Base::getSegmentLength() const
 {
     return segmentLength_var;
 }
 
-void Packet::setSegmentLength(double segmentLength)
+void Packet_Base::setSegmentLength(double segmentLength)
 {
     this->segmentLength_var = segmentLength;
 }
 
-double Packet::getNEstimate() const
+double Packet_Base::getNEstimate() const
 {
     return nEstimate_var;
 }
 
-void Packet::setNEstimate(double nEstimate)
+void Packet_Base::setNEstimate(double nEstimate)
 {
     this->nEstimate_var = nEstimate;
 }
 
-int Packet::getToSenderGateIndex() const
+int Packet_Base::getManager() const
+{
+    return manager_var;
+}
+
+void Packet_Base::setManager(int manager)
 {
-    return toSenderGateIndex_var;
+    this->manager_var = manager;
 }
 
-void Packet::setToSenderGateIndex(int toSenderGateIndex)
+long Packet_Base::getLookupId() const
 {
-    this->toSenderGateIndex_var = toSenderGateIndex;
+    return lookupId_var;
 }
 
-void Packet::setRoutingListArraySize(unsigned int size)
+void Packet_Base::setLookupId(long lookupId)
 {
-    int *routingList_var2 = (size==0) ? NULL : new int[size];
-    unsigned int sz = routingList_arraysize < size ? routingList_arraysize : size;
-    for (unsigned int i=0; i<sz; i++)
-        routingList_var2[i] = this->routingList_var[i];
-    for (unsigned int i=sz; i<size; i++)
-        routingList_var2[i] = 0;
-    routingList_arraysize = size;
-    delete [] this->routingList_var;
-    this->routingList_var = routingList_var2;
+    this->lookupId_var = lookupId;
 }
 
-unsigned int Packet::getRoutingListArraySize() const
+simtime_t Packet_Base::getLookupStart() const
 {
-    return routingList_arraysize;
+    return lookupStart_var;
 }
 
-int Packet::getRoutingList(unsigned int k) const
+void Packet_Base::setLookupStart(simtime_t lookupStart)
 {
-    if (k>=routingList_arraysize) throw cRuntimeError("Array of size %d indexed by %d", routingList_arraysize, k);
-    return routingList_var[k];
+    this->lookupStart_var = lookupStart;
 }
 
-void Packet::setRoutingList(unsigned int k, int routingList)
+int Packet_Base::getLookupHops() const
 {
-    if (k>=routingList_arraysize) throw cRuntimeError("Array of size %d indexed by %d", routingList_arraysize, k);
-    this->routingList_var[k] = routingList;
+    return lookupHops_var;
 }
 
-int Packet::getManager() const
+void Packet_Base::setLookupHops(int lookupHops)
 {
-    return manager_var;
+    this->lookupHops_var = lookupHops;
 }
 
-void Packet::setManager(int manager)
+int Packet_Base::getProtocol() const
 {
-    this->manager_var = manager;
+    return protocol_var;
+}
+
+void Packet_Base::setProtocol(int protocol)
+{
+    this->protocol_var = protocol;
+}
+
+long Packet_Base::getKey() const
+{
+    return key_var;
+}
+
+void Packet_Base::setKey(long key)
+{
+    this->key_var = key;
+}
+
+long Packet_Base::getValue() const
+{
+    return value_var;
+}
+
+void Packet_Base::setValue(long value)
+{
+    this->value_var = value;
+}
+
+bool Packet_Base::getFound() const
+{
+    return found_var;
+}
+
+void Packet_Base::setFound(bool found)
+{
+    this->found_var = found;
+}
+
+double Packet_Base::getManagerX() const
+{
+    return managerX_var;
+}
+
+void Packet_Base::setManagerX(double managerX)
+{
+    this->managerX_var = managerX;
 }
 
-class PacketDescriptor : public cClassDescriptor
+double Packet_Base::getManagerSegmentLength() const
+{
+    return managerSegmentLength_var;
+}
+
+void Packet_Base::setManagerSegmentLength(double managerSegmentLength)
+{
+    this->managerSegmentLength_var = managerSegmentLength;
+}
+
+int Packet_Base::getJoiningMember() const
+{
+    return joiningMember_var;
+}
+
+void Packet_Base::setJoiningMember(int joiningMember)
+{
+    this->joiningMember_var = joiningMember;
+}
+
+class Packet_BaseDescriptor : public cClassDescriptor
 {
   public:
-    PacketDescriptor();
-    virtual ~PacketDescriptor();
+    Packet_BaseDescriptor();
+    virtual ~Packet_BaseDescriptor();
 
     virtual bool doesSupport(cObject *obj) const;
     virtual const char *getProperty(const char *propertyname) const;
@@ -210,34 +301,34 @@ class PacketDescriptor : public cClassDescriptor
     virtual void *getFieldStructPointer(void *object, int field, int i) const;
 };
 
-Register_ClassDescriptor(PacketDescriptor);
+Register_ClassDescriptor(Packet_BaseDescriptor);
 
-PacketDescriptor::PacketDescriptor() : cClassDescriptor("Packet", "cPacket")
+Packet_BaseDescriptor::Packet_BaseDescriptor() : cClassDescriptor("Packet_Base", "cPacket")
 {
 }
 
-PacketDescriptor::~PacketDescriptor()
+Packet_BaseDescriptor::~Packet_BaseDescriptor()
 {
 }
 
-bool PacketDescriptor::doesSupport(cObject *obj) const
+bool Packet_BaseDescriptor::doesSupport(cObject *obj) const
 {
-    return dynamic_cast<Packet *>(obj)!=NULL;
+    return dynamic_cast<Packet_Base *>(obj)!=NULL;
 }
 
-const char *PacketDescriptor::getProperty(const char *propertyname) const
+const char *Packet_BaseDescriptor::getProperty(const char *propertyname) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     return basedesc ? basedesc->getProperty(propertyname) : NULL;
 }
 
-int PacketDescriptor::getFieldCount(void *object) const
+int Packet_BaseDescriptor::getFieldCount(void *object) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
-    return basedesc ? 6+basedesc->getFieldCount(object) : 6;
+    return basedesc ? 15+basedesc->getFieldCount(object) : 15;
 }
 
-unsigned int PacketDescriptor::getFieldTypeFlags(void *object, int field) const
+unsigned int Packet_BaseDescriptor::getFieldTypeFlags(void *object, int field) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -249,14 +340,23 @@ unsigned int PacketDescriptor::getFieldTypeFlags(void *object, int field) const
         FD_ISEDITABLE,
         FD_ISEDITABLE,
         FD_ISEDITABLE,
-        FD_ISEDITABLE,
         FD_ISARRAY | FD_ISEDITABLE,
         FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
     };
-    return (field>=0 && field<6) ? fieldTypeFlags[field] : 0;
+    return (field>=0 && field<15) ? fieldTypeFlags[field] : 0;
 }
 
-const char *PacketDescriptor::getFieldName(void *object, int field) const
+const char *Packet_BaseDescriptor::getFieldName(void *object, int field) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -268,27 +368,45 @@ const char *PacketDescriptor::getFieldName(void *object, int field) const
         "x",
         "segmentLength",
         "nEstimate",
-        "toSenderGateIndex",
         "routingList",
         "manager",
+        "lookupId",
+        "lookupStart",
+        "lookupHops",
+        "protocol",
+        "key",
+        "value",
+        "found",
+        "managerX",
+        "managerSegmentLength",
+        "joiningMember",
     };
-    return (field>=0 && field<6) ? fieldNames[field] : NULL;
+    return (field>=0 && field<15) ? fieldNames[field] : NULL;
 }
 
-int PacketDescriptor::findField(void *object, const char *fieldName) const
+int Packet_BaseDescriptor::findField(void *object, const char *fieldName) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     int base = basedesc ? basedesc->getFieldCount(object) : 0;
     if (fieldName[0]=='x' && strcmp(fieldName, "x")==0) return base+0;
     if (fieldName[0]=='s' && strcmp(fieldName, "segmentLength")==0) return base+1;
     if (fieldName[0]=='n' && strcmp(fieldName, "nEstimate")==0) return base+2;
-    if (fieldName[0]=='t' && strcmp(fieldName, "toSenderGateIndex")==0) return base+3;
-    if (fieldName[0]=='r' && strcmp(fieldName, "routingList")==0) return base+4;
-    if (fieldName[0]=='m' && strcmp(fieldName, "manager")==0) return base+5;
+    if (fieldName[0]=='r' && strcmp(fieldName, "routingList")==0) return base+3;
+    if (fieldName[0]=='m' && strcmp(fieldName, "manager")==0) return base+4;
+    if (fieldName[0]=='l' && strcmp(fieldName, "lookupId")==0) return base+5;
+    if (fieldName[0]=='l' && strcmp(fieldName, "lookupStart")==0) return base+6;
+    if (fieldName[0]=='l' && strcmp(fieldName, "lookupHops")==0) return base+7;
+    if (fieldName[0]=='p' && strcmp(fieldName, "protocol")==0) return base+8;
+    if (fieldName[0]=='k' && strcmp(fieldName, "key")==0) return base+9;
+    if (fieldName[0]=='v' && strcmp(fieldName, "value")==0) return base+10;
+    if (fieldName[0]=='f' && strcmp(fieldName, "found")==0) return base+11;
+    if (fieldName[0]=='m' && strcmp(fieldName, "managerX")==0) return base+12;
+    if (fieldName[0]=='m' && strcmp(fieldName, "managerSegmentLength")==0) return base+13;
+    if (fieldName[0]=='j' && strcmp(fieldName, "joiningMember")==0) return base+14;
     return basedesc ? basedesc->findField(object, fieldName) : -1;
 }
 
-const char *PacketDescriptor::getFieldTypeString(void *object, int field) const
+const char *Packet_BaseDescriptor::getFieldTypeString(void *object, int field) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -302,12 +420,21 @@ const char *PacketDescriptor::getFieldTypeString(void *object, int field) const
         "double",
         "int",
         "int",
+        "long",
+        "simtime_t",
+        "int",
+        "int",
+        "long",
+        "long",
+        "bool",
+        "double",
+        "double",
         "int",
     };
-    return (field>=0 && field<6) ? fieldTypeStrings[field] : NULL;
+    return (field>=0 && field<15) ? fieldTypeStrings[field] : NULL;
 }
 
-const char *PacketDescriptor::getFieldProperty(void *object, int field, const char *propertyname) const
+const char *Packet_BaseDescriptor::getFieldProperty(void *object, int field, const char *propertyname) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -320,7 +447,7 @@ const char *PacketDescriptor::getFieldProperty(void *object, int field, const ch
     }
 }
 
-int PacketDescriptor::getArraySize(void *object, int field) const
+int Packet_BaseDescriptor::getArraySize(void *object, int field) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -328,14 +455,14 @@ int PacketDescriptor::getArraySize(void *object, int field) const
             return basedesc->getArraySize(object, field);
         field -= basedesc->getFieldCount(object);
     }
-    Packet *pp = (Packet *)object; (void)pp;
+    Packet_Base *pp = (Packet_Base *)object; (void)pp;
     switch (field) {
-        case 4: return pp->getRoutingListArraySize();
+        case 3: return pp->getRoutingListArraySize();
         default: return 0;
     }
 }
 
-std::string PacketDescriptor::getFieldAsString(void *object, int field, int i) const
+std::string Packet_BaseDescriptor::getFieldAsString(void *object, int field, int i) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -343,19 +470,28 @@ std::string PacketDescriptor::getFieldAsString(void *object, int field, int i) c
             return basedesc->getFieldAsString(object,field,i);
         field -= basedesc->getFieldCount(object);
     }
-    Packet *pp = (Packet *)object; (void)pp;
+    Packet_Base *pp = (Packet_Base *)object; (void)pp;
     switch (field) {
         case 0: return double2string(pp->getX());
         case 1: return double2string(pp->getSegmentLength());
         case 2: return double2string(pp->getNEstimate());
-        case 3: return long2string(pp->getToSenderGateIndex());
-        case 4: return long2string(pp->getRoutingList(i));
-        case 5: return long2string(pp->getManager());
+        case 3: return long2string(pp->getRoutingList(i));
+        case 4: return long2string(pp->getManager());
+        case 5: return long2string(pp->getLookupId());
+        case 6: return double2string(pp->getLookupStart());
+        case 7: return long2string(pp->getLookupHops());
+        case 8: return long2string(pp->getProtocol());
+        case 9: return long2string(pp->getKey());
+        case 10: return long2string(pp->getValue());
+        case 11: return bool2string(pp->getFound());
+        case 12: return double2string(pp->getManagerX());
+        case 13: return double2string(pp->getManagerSegmentLength());
+        case 14: return long2string(pp->getJoiningMember());
         default: return "";
     }
 }
 
-bool PacketDescriptor::setFieldAsString(void *object, int field, int i, const char *value) const
+bool Packet_BaseDescriptor::setFieldAsString(void *object, int field, int i, const char *value) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -363,19 +499,28 @@ bool PacketDescriptor::setFieldAsString(void *object, int field, int i, const ch
             return basedesc->setFieldAsString(object,field,i,value);
         field -= basedesc->getFieldCount(object);
     }
-    Packet *pp = (Packet *)object; (void)pp;
+    Packet_Base *pp = (Packet_Base *)object; (void)pp;
     switch (field) {
         case 0: pp->setX(string2double(value)); return true;
         case 1: pp->setSegmentLength(string2double(value)); return true;
         case 2: pp->setNEstimate(string2double(value)); return true;
-        case 3: pp->setToSenderGateIndex(string2long(value)); return true;
-        case 4: pp->setRoutingList(i,string2long(value)); return true;
-        case 5: pp->setManager(string2long(value)); return true;
+        case 3: pp->setRoutingList(i,string2long(value)); return true;
+        case 4: pp->setManager(string2long(value)); return true;
+        case 5: pp->setLookupId(string2long(value)); return true;
+        case 6: pp->setLookupStart(string2double(value)); return true;
+        case 7: pp->setLookupHops(string2long(value)); return true;
+        case 8: pp->setProtocol(string2long(value)); return true;
+        case 9: pp->setKey(string2long(value)); return true;
+        case 10: pp->setValue(string2long(value)); return true;
+        case 11: pp->setFound(string2bool(value)); return true;
+        case 12: pp->setManagerX(string2double(value)); return true;
+        case 13: pp->setManagerSegmentLength(string2double(value)); return true;
+        case 14: pp->setJoiningMember(string2long(value)); return true;
         default: return false;
     }
 }
 
-const char *PacketDescriptor::getFieldStructName(void *object, int field) const
+const char *Packet_BaseDescriptor::getFieldStructName(void *object, int field) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -390,11 +535,20 @@ const char *PacketDescriptor::getFieldStructName(void *object, int field) const
         NULL,
         NULL,
         NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
     };
-    return (field>=0 && field<6) ? fieldStructNames[field] : NULL;
+    return (field>=0 && field<15) ? fieldStructNames[field] : NULL;
 }
 
-void *PacketDescriptor::getFieldStructPointer(void *object, int field, int i) const
+void *Packet_BaseDescriptor::getFieldStructPointer(void *object, int field, int i) const
 {
     cClassDescriptor *basedesc = getBaseClassDescriptor();
     if (basedesc) {
@@ -402,7 +556,7 @@ void *PacketDescriptor::getFieldStructPointer(void *object, int field, int i) co
             return basedesc->getFieldStructPointer(object, field, i);
         field -= basedesc->getFieldCount(object);
     }
-    Packet *pp = (Packet *)object; (void)pp;
+    Packet_Base *pp = (Packet_Base *)object; (void)pp;
     switch (field) {
         default: return NULL;
     }
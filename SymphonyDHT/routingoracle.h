@@ -0,0 +1,56 @@
+#ifndef _ROUTINGORACLE_H_
+#define _ROUTINGORACLE_H_
+
+#include <omnetpp.h>
+#include "ringindex.h"
+
+/* ground truth the routing of the whole network is checked against. It holds the true
+ * sorted ring, updated on every join and leave, so that the manager of any point is
+ * known in O(log n). When enabled it counts
+ *
+ * stale segment errors: decisions of a node about being the manager of a point, taken
+ *                       with the segment length it believed, that the ring disproves
+ * misrouted lookups: lookups whose answer named a member that is not the manager of
+ *                    their point when the answer came back
+ * path stretch: hops a sampled lookup took over the hops greedy routing takes on the
+ *               same links when every position is known
+ */
+class RoutingOracle
+{
+  private:
+    RingIndex ring;
+    bool enabled;
+    long managerDecisions;
+    long staleSegmentErrors;
+    long lookupsChecked;
+    long misroutedLookups;
+    long stretchedLookups;
+    double stretchSum;
+    double stretchMax;
+
+  public:
+    RoutingOracle();
+
+    void configure(bool enabled);
+    bool isEnabled() const {return enabled;}
+    /* forgets the ring and the counters of a previous run */
+    void clear();
+
+    void memberJoined(double x, int member) {ring.insert(x, member);}
+    void memberLeft(double x, int member) {ring.remove(x, member);}
+    /* returns the index of the true manager of point p, -1 if the ring is empty */
+    int getManager(double p) const {return ring.getManager(p);}
+    unsigned int size() const {return ring.size();}
+
+    /* member decided whether it is the manager of point p, claimed tells what it decided */
+    void managerDecision(double p, int member, bool claimed);
+    /* a lookup for point p came back naming manager after the hops taken in input,
+     * optimalHops is the hop count of greedy routing with every position known or -1.
+     * Returns the path stretch of the lookup, 0 if it is not defined
+     */
+    double lookupCompleted(double p, int manager, int hops, int optimalHops);
+
+    void record(cModule* recorder);
+};
+
+#endif // _ROUTINGORACLE_H_
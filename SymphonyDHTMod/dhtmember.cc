@@ -3,25 +3,104 @@
 #include <math.h>
 #include <omnetpp.h>
 #include <algorithm>
-#include "packet_m.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include "packet.h"
+#include "dhtlog.h"
+#include "dhtmetrics.h"
+#include "lookuptable.h"
+#include "keystore.h"
+#include "managercache.h"
+#include "routingoracle.h"
+#include "symphonyrouting.h"
 
 #define NONE  -1
 #define RELINK 0
 #define JOIN   1
+#define PUT    2
+#define GET    3
+#define REPAIR 4
 
-double packetsSentOverTheNet=0;
+/* manager index carried back by lookups rejected on the way, see rejectLookup() */
+#define NO_MANAGER -1
+
+/* neighbour position not known yet, real positions lie in [0, 1) */
+#define POSITION_UNKNOWN -1.0
+
+/* length of a long link current node did not draw, drawn lengths lie in (0, 1] */
+#define LENGTH_UNKNOWN -1.0
+
+/* routing list entry of a hop member i took directly to a cached manager, instead of a
+ * gate index. The mapping is its own inverse, it also gives back i from the entry
+ */
+#define DIRECT_HOP(i) (-1 - (i))
+
+/* statistics modes, see statisticsMode parameter in package.ned */
+#define STATISTICS_EVERY_EVENT 0
+#define STATISTICS_ON_CHANGE   1
+#define STATISTICS_INTERVAL    2
+#define STATISTICS_END_ONLY    3
+
+/* routing modes, see routing parameter in package.ned */
+#define ROUTING_GREEDY    0
+#define ROUTING_LOOKAHEAD 1
+
+/* directions a lookup can travel the ring, see routingDirection parameter in package.ned */
+#define DIRECTION_CLOCKWISE     0
+#define DIRECTION_BIDIRECTIONAL 1
+
+/* distributions storage workload keys are drawn from, see keyDistribution parameter in package.ned */
+#define KEYS_UNIFORM 0
+#define KEYS_ZIPF    1
+
+/* queue overflow policies of the service model, see queueOverflow parameter in package.ned */
+#define OVERFLOW_REJECT 0
+#define OVERFLOW_DROP   1
+
+/* latency models of the links between members */
+#define LATENCY_FIXED       0
+#define LATENCY_COORDINATES 1
+
+/* session length distributions of the churn model, see churn parameter in package.ned */
+#define CHURN_NONE        0
+#define CHURN_EXPONENTIAL 1
+#define CHURN_PARETO      2
+
+/* relink modes, see relinkMode parameter in package.ned */
+#define RELINK_FULL        0
+#define RELINK_INCREMENTAL 1
+
+/* bytes of the header carried by every packet, and of every entry of the routing list */
+#define PACKET_HEADER_BYTES        28
+#define ROUTING_LIST_ENTRY_BYTES   4
 
 class DHTMember : public cSimpleModule {
     public:
+        DHTMember() {statisticsTimer = NULL; storageTimer = NULL; serviceTimer = NULL;}
+        virtual ~DHTMember() {cancelAndDelete(statisticsTimer); cancelAndDelete(storageTimer); cancelAndDelete(serviceTimer);}
+
         void finish() {
-            if(packetsSentOverTheNet > 0){
+            if(DHTMetrics::getNetworkPacketsSent() > 0){
+                if (statisticsMode == STATISTICS_END_ONLY)
+                    collectStatistics();
                 recordScalar("#packetsInTheNetwork",packetsSentByMe);
                 packetsInNetworkHistogram.recordAs("packets statistics");
             }
+            metrics.record();
+            recordScalar("#storedKeys", keys.size());
+            if (getIndex() == 0) {
+                DHTMetrics::recordNetwork(this);
+                recordStorageLoad();
+                recordScalar("#packetPoolHits", packetPoolHits);
+                recordScalar("#packetPoolMisses", packetPoolMisses);
+                oracle.record(this);
+            }
         }
     private:
         /* x: represents the position in the unit interval of this node
-         * segmentLength: length of the segment between this node and its previous neighbour
+         * segmentLength: length of the segment between this node and its previous neighbour,
+         *                kept up to date whenever either position or the previous neighbour change
          * nEstimate: estimated number of nodes in the DHT
          * nEstimateAtLinking: estimated number of nodes in the DHT during last relinking
          */
@@ -31,6 +110,9 @@ class DHTMember : public cSimpleModule {
         int nEstimateAtLinking;
         int runningProtocol;
 
+        /* highest level of the protocol log printed by this node, see dhtlog.h */
+        int logLevel;
+
         /* private variables for estimation protocol
          *
          * neighboursTotalSegmentsLengths: partial total of short linked neighbours segment lengths
@@ -39,24 +121,240 @@ class DHTMember : public cSimpleModule {
         double neighboursTotalSegmentsLengths;
         int receivedSegments;
 
-        /* private variables for relinking protocol */
-        double randomPoint;
-        double bestDistanceFoundSoFar;
-        int gateIndexToClosestNode;
-        int repliesToFindShortestPath;
+        /* private variables for relinking protocol
+         *
+         * longLinksCreated: lookups of the running relink that got their answer
+         * relinkLookupsPending: lookups of the running relink still waiting for an answer
+         * relinkProtocol: RELINK, or REPAIR if the running relink replaces long links
+         *                 lost to a departed node
+         * relinkStart: time the running relink started, or the departure it repairs
+         * repairPending: a node departed during the running relink, its long links
+         *                are repaired once the relink is complete
+         * repairDeparture: time of the first departure the pending repair is for
+         * relinkMode: one of the RELINK_* modes
+         * pendingLookups: protocol of every lookup started by current node and not
+         *                 answered yet, keyed by lookup ID
+         */
         int longLinksCreated;
+        int relinkLookupsPending;
+        int relinkProtocol;
+        simtime_t relinkStart;
+        bool repairPending;
+        simtime_t repairDeparture;
+        int relinkMode;
+        LookupTable pendingLookups;
 
         cLongHistogram packetsInNetworkHistogram;
         cOutVector packetsInNetworkVector;
         double packetsSentByMe;
 
+        /* traffic and lookup metrics of current node */
+        DHTMetrics metrics;
+
+        /* storage layer and its workload, see package.ned
+         *
+         * keys: key/value pairs which positions current node is the manager of
+         * storageTimer: self message starting the next storage operation of the workload
+         * storageRate: storage operations started per second, 0 if there is no workload
+         * keySpace: number of distinct keys used by the workload
+         * keyDistribution: one of the KEYS_* distributions workload keys are drawn from
+         * zipfSkew: exponent of the zipf distribution, key k is drawn with probability
+         *           proportional to 1 / (k + 1)^zipfSkew
+         * readRatio: fraction of storage operations that are gets
+         * storageOperationsStarted: storage operations started by current node
+         * zipfCdf: cumulative zipf distribution over the key space, shared by every member
+         * zipfCdfSkew: exponent zipfCdf was computed for
+         */
+        KeyStore keys;
+        cMessage* storageTimer;
+        double storageRate;
+        long keySpace;
+        int keyDistribution;
+        double zipfSkew;
+        double readRatio;
+        long storageOperationsStarted;
+        static std::vector<double> zipfCdf;
+        static double zipfCdfSkew;
+
+        /* segments of managers learned from answers to lookups routed through current
+         * node, see managerCacheSize and managerCacheTimeout parameters in package.ned
+         */
+        ManagerCache managerCache;
+
+        /* true ring shared by every member, managers of points are found in it by binary
+         * search. Routing decisions and answers are checked against it, see
+         * routingOracle parameter in package.ned
+         */
+        static RoutingOracle oracle;
+        /* share of the lookups started by current node whose path stretch is measured */
+        double pathStretchSampling;
+
+        /* churn model, see churn parameter in package.ned
+         *
+         * churnModel: one of the CHURN_* distributions sessions are drawn from
+         * sessionLength: mean time current node stays in the network once it joined
+         * paretoShape: shape of the pareto distribution of sessions
+         * downtime: mean time current node stays out of the network once it left
+         * lookupTimeout: time a lookup started by current node waits for its answer,
+         *                0 to wait forever
+         * session: sessions current node left so far, lookups are tagged with it
+         * networkMembers: indexes of the members in the network, joining nodes take
+         *                 one of them at random as their bootstrap server
+         * networkMembersSlot: position of current node in networkMembers, -1 out of it
+         */
+        int churnModel;
+        simtime_t sessionLength;
+        double paretoShape;
+        simtime_t downtime;
+        simtime_t lookupTimeout;
+        int session;
+        static std::vector<int> networkMembers;
+        int networkMembersSlot;
+
+        /* service model, see serviceTime parameter in package.ned
+         *
+         * serviceModelEnabled: true if packets from other nodes wait in a queue for service
+         * serviceTimes: time current node takes to handle a packet, for each opcode
+         * queueCapacity: packets the queue holds before it overflows
+         * queueOverflow: one of the OVERFLOW_* policies
+         * throttleStorage: a full queue stops the storage workload of current node
+         * serviceQueue: packets waiting for service, the head one is being served
+         * serviceTimer: self message firing when the head of the queue has been served
+         */
+        bool serviceModelEnabled;
+        simtime_t serviceTimes[OPCODES_NUMBER];
+        int queueCapacity;
+        int queueOverflow;
+        bool throttleStorage;
+        std::deque<Packet*> serviceQueue;
+        cMessage* serviceTimer;
+
+        /* link model, see latencyModel parameter in package.ned
+         *
+         * latencyModel: one of the LATENCY_* models
+         * linkDelay: delay of every link under LATENCY_FIXED, delay per unit of
+         *            distance between coordinates under LATENCY_COORDINATES
+         * minLinkDelay: delay of a link between members at the same coordinates
+         * linkDatarate: datarate of every link in bit/s, 0 for no transmission delay
+         * valueBytes: bytes of a value carried by puts and by gets that found it
+         * coordX, coordY: network coordinates of current node in the unit square
+         * opcodeBytes: payload bytes of every protocol opcode
+         */
+        int latencyModel;
+        simtime_t linkDelay;
+        simtime_t minLinkDelay;
+        double linkDatarate;
+        int valueBytes;
+        double coordX;
+        double coordY;
+        static const int opcodeBytes[OPCODES_NUMBER];
+
+        /* sampling of packetsInNetworkHistogram and packetsInNetworkVector
+         *
+         * statisticsMode: one of the STATISTICS_* modes
+         * statisticsInterval: sampling period of STATISTICS_INTERVAL mode
+         * statisticsTimer: self message firing the next interval sample
+         * lastCollectedPacketsSentByMe: value of packetsSentByMe at last sample
+         */
+        int statisticsMode;
+        simtime_t statisticsInterval;
+        cMessage* statisticsTimer;
+        double lastCollectedPacketsSentByMe;
+
+        /* opcode dispatch: handler and debug label of every protocol opcode */
+        typedef void (DHTMember::*PacketHandler)(Packet* request, int toSenderGateIndex);
+        static const PacketHandler handlers[OPCODES_NUMBER];
+        static const char* opcodeLabels[OPCODES_NUMBER];
+
+        /* packet pool shared by every member of the simulation
+         *
+         * packetPool: free list of packets that can be sent again
+         * packetPoolHits: packets taken from the free list
+         * packetPoolMisses: packets allocated because the free list was empty
+         * requestReused: true if the handler of current request sends the request itself
+         */
+        static std::vector<Packet*> packetPool;
+        static long packetPoolHits;
+        static long packetPoolMisses;
+        bool requestReused;
+
+        /* neighbour table, one entry for each gate index. It is updated only when
+         * a link is created or dropped, so that neighbours are never looked up on gates
+         *
+         * member: neighbour connected through that gate, NULL if the gate is unconnected
+         * x: interval position of that neighbour
+         * reverseGateIndex: index of the gate of that neighbour connected to current node
+         * outGate: output gate of current node with that index
+         * linkLength: harmonic length current node drew for that long link, LENGTH_UNKNOWN
+         *             for short links and for long links drawn by the other end
+         * retiring: that long link is no longer a harmonic sample for the estimate, the
+         *           running incremental relink swaps it for the next long link it creates
+         * neighbourPositions: positions of the neighbours of that neighbour, as last published
+         *                     by it. Kept in lookahead routing mode only
+         * neighboursNumber: number of gates of current node that are connected
+         */
+        struct Neighbour {
+            DHTMember* member;
+            double x;
+            int reverseGateIndex;
+            cGate* outGate;
+            double linkLength;
+            bool retiring;
+            std::vector<double> neighbourPositions;
+        };
+        std::vector<Neighbour> neighbours;
+        int neighboursNumber;
+
+        /* one of the ROUTING_* modes used to choose the next hop of a lookup
+         * and one of the DIRECTION_* modes used to measure distances to its point
+         */
+        int routingMode;
+        int routingDirection;
+
     protected:
-        virtual void initialize();
+        virtual int numInitStages() const {return 3;}
+        virtual void initialize(int stage);
         virtual void handleMessage(cMessage* msg);
+        virtual void processPacket(Packet* request);
+        virtual void collectStatistics();
+        virtual int getStatisticsModeByName(const char* mode);
+        virtual int getRoutingDirectionByName(const char* direction);
+        virtual int getKeyDistributionByName(const char* distribution);
+        virtual int getQueueOverflowByName(const char* policy);
+        virtual int getLatencyModelByName(const char* model);
+        virtual int getChurnModelByName(const char* model);
+        virtual int getRelinkModeByName(const char* mode);
+        virtual void parseServiceTimes(simtime_t serviceTime, const char* overrides);
+        virtual double getDistanceToPoint(double position, double point);
+        virtual int getRoutingModeByName(const char* mode);
+
+        /* protocol handlers, one for each opcode */
+        virtual void handleSegmentLengthRequest(Packet* request, int toSenderGateIndex);
+        virtual void handleSegmentLengthReply(Packet* request, int toSenderGateIndex);
+        virtual void handleEstimateUpdate(Packet* request, int toSenderGateIndex);
+        virtual void handleManagerCheck(Packet* request, int toSenderGateIndex);
+        virtual void handleManagerQuery(Packet* request, int toSenderGateIndex);
+        virtual void handleManagerIndex(Packet* request, int toSenderGateIndex);
+        virtual void handleJoinNetwork(Packet* request, int toSenderGateIndex);
+        virtual void handleLeaveNetwork(Packet* request, int toSenderGateIndex);
+        virtual void handleRelinkRequest(Packet* request, int toSenderGateIndex);
+        virtual void handleLookupTimeout(Packet* request, int toSenderGateIndex);
 
         /* utility methods */
+        virtual Packet* createPacket(int opcode);
+        virtual Packet* createReply(Packet* request, int opcode);
+        virtual Packet* reuseRequest(Packet* request, int opcode);
+        virtual Packet* acquirePacket();
+        virtual void releasePacket(Packet* packet);
+        virtual void sendPacket(Packet* packet, int gateIndex);
+        virtual void sendPacket(Packet* packet, cGate* outGate);
+        virtual void sendPacketDirect(Packet* packet, DHTMember* member);
+        virtual void sendBackAlongRoutingList(Packet* packet);
+        virtual int getPacketBytes(Packet* packet);
+        virtual simtime_t getLinkDelay(DHTMember* member);
+        virtual void configureLinkChannel(cDatarateChannel* channel, DHTMember* member);
+        virtual const char* getOpcodeLabel(int opcode);
         virtual double getSegmentLengthByPreviousNodesIntervalPosition(double previousNodeX);
-        virtual int getGateToModule(cModule* module);
         virtual int getNeighboursNumber();
         virtual int getReverseGateIndexByGateIndex(int index);
         virtual bool needToRelink();
@@ -64,36 +362,116 @@ class DHTMember : public cSimpleModule {
         virtual bool alreadyConnected(DHTMember* member);
         virtual bool amIManagerForPoint(double p);
         virtual void sendToBestNeighbour(Packet* msg);
-        virtual int getBestNeighbourIndex();
+        virtual int getBestNeighbourIndex(double point);
+        virtual void publishNeighbourPositions();
         virtual void broadcastOnLongLinks(Packet* msg);
-        virtual void createLongLinkToMember(int index);
+        virtual void createLongLinkToMember(int index, double length);
         virtual void createLongLinkByFirstUnconnectedGate(DHTMember* member);
         virtual void createLongLinkDisconnectingLastConnectedGate(DHTMember* member);
-        virtual void disconnectGate(cGate* toDisconnect);
+        virtual void createLongLinkSwappingGate(int gateIndex, DHTMember* member);
+        virtual void connectGate(int gateIndex, DHTMember* member, int memberGateIndex);
+        virtual void disconnectGate(int gateIndex);
+        virtual void setNeighbour(int gateIndex, DHTMember* member, int reverseGateIndex);
+        virtual void clearNeighbour(int gateIndex);
+        virtual void refreshPositionInNeighbourTables();
         virtual void dropAllLongLinks();
         virtual void routingProtocol(double randx, int protocol);
-        virtual cGate* getLastConnectedGate(const char* gateRef);
-        virtual cGate* getFirstUnconnectedGate(const char* gateRef);
-        virtual DHTMember* addNodeWithSpecificIntervalPosition(double randx, int manager);
-        virtual DHTMember* getMemberWithSpecificIntervalPosition(double randx);
+        virtual void joinLookup(double randx, int joiningMember);
+        virtual Packet* createLookup(double randx, int protocol);
+        virtual void startLookup(Packet* request);
+        virtual int lookupCompleted(Packet* reply);
+        virtual int getOptimalGreedyHops(double point);
+        virtual void relinkLookupCompleted();
+        virtual void relinkCompleted();
+        virtual void executeStorageOperation(Packet* request);
+        virtual void storageOperationCompleted(Packet* reply, int protocol);
+        virtual bool isInNetwork();
+        virtual long chooseKey();
+        virtual void computeZipfCdf();
+        virtual void recordStorageLoad();
+        virtual bool routeByManagerCache(Packet* request);
+        virtual void invalidateManagerCaches(double point);
+        virtual void enqueuePacket(Packet* request);
+        virtual void startService();
+        virtual void finishService();
+        virtual void rejectLookup(Packet* request);
+        virtual void lookupRejected(Packet* reply, int protocol);
+        virtual int getLastConnectedGateIndex();
+        virtual int getRetiringGateIndex();
+        virtual int getLongLinksNumber();
+        virtual int getFirstUnconnectedGateIndex();
+        virtual DHTMember* addJoiningMember(int joiningMemberIndex, int manager);
+        virtual DHTMember* getMember(int index);
 
         /* symphony DHT protocol methods */
-        virtual void calculateSegmentLength();
+        virtual void updateSegmentLength();
+        virtual void updateSegmentLength(double previousX);
         virtual void calculateNEstimate();
-        virtual void relink();
+        virtual void relink(int protocol, simtime_t start);
         virtual void join(simtime_t delay);
         virtual void leave(simtime_t delay);
+        virtual void startSession();
+        virtual simtime_t getSessionLength();
+
+        /* storage layer methods */
+        virtual void put(long key, long value);
+        virtual void get(long key);
+        virtual void startStorageOperation();
 };
 
 Define_Module(DHTMember);
 
+std::vector<Packet*> DHTMember::packetPool;
+long DHTMember::packetPoolHits = 0;
+long DHTMember::packetPoolMisses = 0;
+std::vector<double> DHTMember::zipfCdf;
+double DHTMember::zipfCdfSkew = 0;
+RoutingOracle DHTMember::oracle;
+std::vector<int> DHTMember::networkMembers;
+
 /* ===========================================
  * |             omnet++ methods             |
  * ===========================================
  */
 
-void DHTMember::initialize() {
+void DHTMember::initialize(int stage) {
+    /* neighbours of neighbours are published once every neighbour table is filled */
+    if (stage == 2) {
+        publishNeighbourPositions();
+        return;
+    }
+
+    /* neighbour tables are filled once every member knows its interval position */
+    if (stage == 1) {
+        int i;
+        cGate* neighbourGate;
+        Neighbour unconnected;
+
+        unconnected.member = NULL;
+        unconnected.x = POSITION_UNKNOWN;
+        unconnected.reverseGateIndex = -1;
+        unconnected.linkLength = LENGTH_UNKNOWN;
+        unconnected.retiring = false;
+        neighboursNumber = 0;
+        for (i=0; i<gateSize("gate$o"); i++) {
+            unconnected.outGate = gate("gate$o", i);
+            neighbours.push_back(unconnected);
+
+            neighbourGate = unconnected.outGate->getNextGate();
+            if (neighbourGate != NULL)
+                setNeighbour(i, (DHTMember*)neighbourGate->getOwnerModule(), neighbourGate->getIndex());
+        }
+
+        /* links declared in package.ned follow the same link model of links created later */
+        for (i=0; i<(int)neighbours.size(); i++) {
+            if (neighbours[i].member != NULL)
+                configureLinkChannel(check_and_cast<cDatarateChannel*>(neighbours[i].outGate->getChannel()), neighbours[i].member);
+        }
+        return;
+    }
+
     double connected = (double)getAncestorPar("connected");
+    logLevel = parseDHTLogLevel(par("logLevel"));
     simtime_t delay = exponential(10);
 
     x = getIndex() / connected;
@@ -105,19 +483,114 @@ void DHTMember::initialize() {
     neighboursTotalSegmentsLengths = 0;
     receivedSegments = 0;
 
-    bestDistanceFoundSoFar = 42; /* note: every number >= than 1 could be considered +infinity */
-    repliesToFindShortestPath = 0;
     longLinksCreated = 0;
+    relinkLookupsPending = 0;
+    relinkProtocol = RELINK;
+    relinkStart = 0;
+    repairPending = false;
+    repairDeparture = 0;
+    relinkMode = getRelinkModeByName(par("relinkMode"));
 
     packetsSentByMe=0;
+    metrics.initialize(this);
+    lastCollectedPacketsSentByMe = 0;
+    statisticsMode = getStatisticsModeByName(par("statisticsMode"));
+    routingDirection = getRoutingDirectionByName(par("routingDirection"));
+    routingMode = getRoutingModeByName(par("routing"));
+    statisticsInterval = par("statisticsInterval");
+    if (statisticsMode == STATISTICS_INTERVAL)
+        statisticsTimer = new cMessage("statisticsTimer");
+    requestReused = false;
+
+    storageRate = par("storageRate");
+    keySpace = par("keySpace");
+    keyDistribution = getKeyDistributionByName(par("keyDistribution"));
+    zipfSkew = par("zipfSkew");
+    readRatio = par("readRatio");
+    storageOperationsStarted = 0;
+    if (keySpace <= 0)
+        throw cRuntimeError("DHTMember: keySpace must be positive, got %ld", keySpace);
+
+    /* the distribution is computed once and shared, unless another run changed it */
+    if (keyDistribution == KEYS_ZIPF && ((long)zipfCdf.size() != keySpace || zipfCdfSkew != zipfSkew))
+        computeZipfCdf();
+
+    /* nodes out of the network skip operations until they join */
+    if (storageRate > 0) {
+        storageTimer = new cMessage("storageTimer");
+        scheduleAt(simTime() + exponential(1 / storageRate), storageTimer);
+    }
+
+    managerCache.configure((int)par("managerCacheSize"), par("managerCacheTimeout"));
+
+    parseServiceTimes(par("serviceTime"), par("opcodeServiceTimes"));
+    queueCapacity = par("queueCapacity");
+    queueOverflow = getQueueOverflowByName(par("queueOverflow"));
+    throttleStorage = par("throttleStorage");
+    if (serviceModelEnabled)
+        serviceTimer = new cMessage("serviceTimer");
+
+    latencyModel = getLatencyModelByName(par("latencyModel"));
+    linkDelay = par("linkDelay");
+    minLinkDelay = par("minLinkDelay");
+    linkDatarate = par("linkDatarate");
+    valueBytes = par("valueBytes");
+    /* coordinates are drawn here so that every member has them before links are set up */
+    coordX = 0;
+    coordY = 0;
+    if (latencyModel == LATENCY_COORDINATES) {
+        coordX = uniform(0, 1);
+        coordY = uniform(0, 1);
+    }
+
+    churnModel = getChurnModelByName(par("churn"));
+    sessionLength = par("sessionLength");
+    paretoShape = par("paretoShape");
+    downtime = par("downtime");
+    lookupTimeout = par("lookupTimeout");
+    session = 0;
+    networkMembersSlot = -1;
+    if (churnModel == CHURN_PARETO && paretoShape <= 1)
+        throw cRuntimeError("DHTMember: paretoShape must be greater than 1, got %g", paretoShape);
+    /* lookups routed through departed members are lost, their origins must give up on them */
+    if (churnModel != CHURN_NONE && lookupTimeout <= 0)
+        throw cRuntimeError("DHTMember: churn needs a positive lookupTimeout");
+    /* full queues drop answers as well, their origins must give up on them */
+    if (serviceModelEnabled && lookupTimeout <= 0)
+        throw cRuntimeError("DHTMember: the service model needs a positive lookupTimeout");
+
+    /* network counters belong to a single run, packets pooled during a previous
+     * run were deleted together with their owners
+     */
+    if (getIndex() == 0) {
+        DHTMetrics::resetNetwork();
+        packetPool.clear();
+        packetPoolHits = 0;
+        packetPoolMisses = 0;
+        oracle.clear();
+        oracle.configure(par("routingOracle"));
+        networkMembers.clear();
+    }
+    pathStretchSampling = par("pathStretchSampling");
+    if (pathStretchSampling < 0 || pathStretchSampling > 1)
+        throw cRuntimeError("DHTMember: pathStretchSampling must lie in [0, 1], got %g", pathStretchSampling);
+    if (getIndex() < connected) {
+        oracle.memberJoined(x, getIndex());
+        startSession();
+    }
 
     WATCH(x);
     WATCH(segmentLength);
     WATCH(nEstimate);
     WATCH(nEstimateAtLinking);
     WATCH(runningProtocol);
+    WATCH(longLinksCreated);
+    WATCH(relinkLookupsPending);
     WATCH(packetsSentByMe);
-    WATCH(packetsSentOverTheNet);
+    WATCH(packetPoolHits);
+    WATCH(packetPoolMisses);
+    WATCH(neighboursNumber);
+    WATCH(storageOperationsStarted);
 
     /* each node not in the DHT Network will enter the network sooner or later */
     simtime_t lastEnter = 0;
@@ -131,605 +604,1120 @@ void DHTMember::initialize() {
         //join(lastEnter + ar);
         //lastEnter += ar;
         join(100.0 * (getIndex() + 1) + ar);
-        EV<<"DHTMember["<< getIndex()<<"]: DHTSize=" << size <<"; accessRate=" <<ar<< "; will join in "<< 100.0 * (getIndex() + 1) + ar <<endl;
+        DHT_INFO <<"DHTMember["<< getIndex()<<"]: DHTSize=" << size <<"; accessRate=" <<ar<< "; will join in "<< 100.0 * (getIndex() + 1) + ar <<endl;
     }
 
     /* DEBUG */
     if (getIndex() == 0) {
         /*
-        EV << "DHTMember: " << this->getFullName() << " starts procedure to calculate its segment length." << endl;
-        calculateSegmentLength();
-
-        EV << "DHTMember: " << this->getFullName() << " starts procedure to estimate the number of nodes in the DHT." << endl;
+        DHT_TRACE << "DHTMember: " << this->getFullName() << " starts procedure to estimate the number of nodes in the DHT." << endl;
         calculateNEstimate();
 
-        EV << "DHTMember: " << this->getFullName() << " starts relinking procedure." << endl;
-        relink();
+        DHT_TRACE << "DHTMember: " << this->getFullName() << " starts relinking procedure." << endl;
+        relink(RELINK, simTime());
         */
     }
 }
 
-void DHTMember::handleMessage(cMessage* msg) {
-    Packet* request = check_and_cast<Packet*>(msg);
-    Packet* response;
-    cGate* toSender;
-    int toSenderGateIndex;
+/* handlers for every protocol opcode, indexed by the message kind.
+ * Entries must follow the order of enum Opcode in packet.msg
+ */
+const DHTMember::PacketHandler DHTMember::handlers[OPCODES_NUMBER] = {
+    &DHTMember::handleSegmentLengthRequest,       /* SEGMENT_LENGTH_REQUEST */
+    &DHTMember::handleSegmentLengthReply,         /* SEGMENT_LENGTH_REPLY */
+    &DHTMember::handleEstimateUpdate,             /* ESTIMATE_UPDATE */
+    &DHTMember::handleManagerCheck,               /* MANAGER_CHECK */
+    &DHTMember::handleManagerQuery,               /* MANAGER_QUERY */
+    &DHTMember::handleManagerIndex,               /* MANAGER_INDEX */
+    &DHTMember::handleJoinNetwork,                /* JOIN_NETWORK */
+    &DHTMember::handleLeaveNetwork,               /* LEAVE_NETWORK */
+    &DHTMember::handleRelinkRequest,              /* RELINK_REQUEST */
+    &DHTMember::handleLookupTimeout               /* LOOKUP_TIMEOUT */
+};
 
-    if(packetsSentOverTheNet > 0) {
-        packetsInNetworkHistogram.collect(packetsSentByMe);
-        packetsInNetworkVector.record(packetsSentByMe);
-    }
+/* debug labels for every protocol opcode, they are the names messages had
+ * when they were dispatched by name. Same order of enum Opcode in packet.msg
+ */
+const char* DHTMember::opcodeLabels[OPCODES_NUMBER] = {
+    "needYourSegmentLength",
+    "thisIsMySegmentLength",
+    "updateYourEstimate",
+    "amITheManagerOfThisPoint?",
+    "areYouTheManagerOfThisPoint?",
+    "managerIndexIs",
+    "joinNetwork",
+    "leaveNetwork",
+    "youMustRelink",
+    "lookupTimedOut"
+};
 
-    toSenderGateIndex = getGateToModule(msg->getSenderModule());
+/* payload bytes of every protocol opcode, not counting the header, the routing
+ * list and stored values. Lookups carry point, ID, start time, hops, protocol,
+ * key and joining member, answers to lookups add the manager index and its segment.
+ * Same order of enum Opcode in packet.msg
+ */
+const int DHTMember::opcodeBytes[OPCODES_NUMBER] = {
+    0,      /* SEGMENT_LENGTH_REQUEST */
+    8,      /* SEGMENT_LENGTH_REPLY */
+    8,      /* ESTIMATE_UPDATE */
+    44,     /* MANAGER_CHECK */
+    44,     /* MANAGER_QUERY */
+    65,     /* MANAGER_INDEX */
+    8,      /* JOIN_NETWORK */
+    0,      /* LEAVE_NETWORK */
+    8,      /* RELINK_REQUEST */
+    0       /* LOOKUP_TIMEOUT, a self-message */
+};
 
-    if (toSenderGateIndex >= 0)
-        toSender = gate("gate$o", toSenderGateIndex);
+void DHTMember::handleMessage(cMessage* msg) {
+    Packet* request;
+    int opcode;
 
-    if (request->isName("needYourIntervalPositionToCalculateMySegmentLength")) {
-        /* a node asked position of current node on unit interval in order to
-         * calculate its segment length. A message with that position in sent back
-         */
-        response = request->dup();
-        response->setName("thisIsMyIntervalPosition");
-        response->setX(x);
-        packetsSentOverTheNet++; packetsSentByMe++; send(response, toSender);
-        EV << "DHTMember: " << request->getSenderModule()->getFullName() << " asked for interval position of " << this->getFullName() << " that is: " << x << ". Sending it back." << endl;
-    } else if (request->isName("thisIsMyIntervalPosition")) {
-        /* a message with the position of a node has been received,
-         * that was requested in order to calculate current node segment length.
-         * current node segment length is then updated
-         */
-        segmentLength = getSegmentLengthByPreviousNodesIntervalPosition(request->getX());
-        EV << "DHTMember: " << request->getSenderModule()->getFullName() << " sent its interval position to " << this->getFullName() << " that is: " << request->getX() << ". Updating segment length to " << segmentLength << "." << endl;
-    } else if (request->isName("needYourSegmentLength")) {
-        /* a node asked for current node segment length in order to calculate an estimate of
-         * the number of nodes in the DHT. Segment length for current node will be
-         * available in 0.3 simulated time steps
-         */
-        calculateSegmentLength();
-
-        response = request->dup();
-        response->setName("mySegmentLengthIsReady");
-        response->setToSenderGateIndex(toSenderGateIndex);
-        scheduleAt(simTime() + 0.3, response);
-        EV << "DHTMember: " << request->getSenderModule()->getFullName() << " asked for segment length of " << this->getFullName() << ". This calculus will take 0.3 simulated time steps." << endl;
-    } else if (request->isName("mySegmentLengthIsReady")) {
-        /* on this self message segment length for this node is known;
-         * it is sent back to the node who made the request in order to calculate
-         * an estimate of the number of nodes in the DHT
-         */
-        response = request->dup();
-        response->setName("thisIsMySegmentLength");
-        response->setSegmentLength(segmentLength);
-        packetsSentOverTheNet++; packetsSentByMe++; send(response, gate("gate$o", request->getToSenderGateIndex()));
-        EV << "DHTMember: segment length of node " << this->getFullName() << " that is " << segmentLength << " is now ready. Sending it back." << endl;
-    } else if (request->isName("thisIsMySegmentLength")) {
-        /* the segment length of a neighbour has been received,
-         * sum it up to local partial total
-         */
-        neighboursTotalSegmentsLengths += request->getSegmentLength();
-        /* notify a segment has been received */
-        receivedSegments++;
+    if (statisticsMode == STATISTICS_EVERY_EVENT)
+        collectStatistics();
 
-        EV << "DHTMember: node " << this->getFullName() << " received segment length of node " << request->getSenderModule()->getFullName() << " that is " << request->getSegmentLength() << " is now ready. Sending it back." << endl;
-        EV << "DHTMember: received " << receivedSegments << "/2 segment lengths." << endl;
+    if (msg == statisticsTimer) {
+        collectStatistics();
+        return;
+    }
 
-        /* if both segments have been received update current estimate of
-         * the number of nodes in the DHT
-         */
-        if (receivedSegments == 2) {
-            nEstimate = 3 / (neighboursTotalSegmentsLengths + segmentLength);
-            neighboursTotalSegmentsLengths = 0;
-            receivedSegments = 0;
-
-            EV << "DHTMember: both segment were received. Estimate for n is " << nEstimate << "." << endl;
-
-            /* send back calculated estimate to neighbours */
-            int i;
-            for (i=0; i<2; i++) {
-                response = request->dup();
-                response->setName("updateYourEstimate");
-                response->setNEstimate(nEstimate);
-                packetsSentOverTheNet++; packetsSentByMe++; send(response, "gate$o", i);
-            }
+    if (msg == storageTimer) {
+        startStorageOperation();
+        scheduleAt(simTime() + exponential(1 / storageRate), storageTimer);
+        return;
+    }
 
-            EV << "DHTMember: asking neighbours to update their estimates for n to " << nEstimate << "." << endl;
+    if (msg == serviceTimer) {
+        finishService();
+        return;
+    }
 
-            /* start relink procedure on nEstimate update after join */
-            if (runningProtocol == JOIN) {
-                relink();
-            }
-       }
-    } else if (request->isName("updateYourEstimate")) {
-        /* a node completed the calculus of an estimate of the number of
-         * nodes in the DHT. It notified to current node that value,
-         * then estimate of the number of nodes in the DHT is updated
-         * for current node too
-         */
-        nEstimate = request->getNEstimate();
+    request = check_and_cast<Packet*>(msg);
+    opcode = request->getKind();
 
-        /* if updated estimate is too old, relink */
-        if (needToRelink())
-            relink();
+    /* interval mode arms the timer on activity only, so that an idle
+     * network is not kept alive by pending statistics events
+     */
+    if (statisticsMode == STATISTICS_INTERVAL && !statisticsTimer->isScheduled())
+        scheduleAt(simTime() + statisticsInterval, statisticsTimer);
 
-        EV << "DHTMember: " << request->getSenderModule()->getFullName() << " asked to " << this->getFullName() << " to update its estimate for n that is " << request->getNEstimate() << "." << endl;
-    } else if (request->isName("amITheManagerOfThisPoint?")) {
-        /* current nodes asks itself if it is the manager for
-         * randomly generated point. When this message is received
-         * current node has updated its segment length
-         */
-        EV << "DHTMember: node " << this->getFullName() << " asks itself if it is the manager for point " << request->getX() << "." << endl;
-
-        int routinglistSize;
-        int previousRequestingNodeGateIndex;
-
-        if (amIManagerForPoint(request->getX())) {
-            /* if current node is the manager for randomly generated point */
-            EV << "DHTMember: node " << this->getFullName() << " is the manager for that point." << endl;
-            routinglistSize = request->getRoutingListArraySize();
-            if (routinglistSize > 0) {
-                /* if information about the manager have not been transmitted
-                 * to the node who made the request for it
-                 */
-                EV << "DHTMember: node " << this->getFullName() << " is not the requesting node so it passes backwards the message deleting itself from routing list." << endl;
-
-                /* current node passes backwards its message along requesting chain (routing list) */
-                previousRequestingNodeGateIndex = request->getRoutingList(routinglistSize - 1);
-                response = request->dup();
-                response->setName("managerIndexIs");
-                response->setManager(getIndex());
-                response->setRoutingListArraySize(routinglistSize - 1);
-                packetsSentOverTheNet++; packetsSentByMe++; send(response, gate("gate$o", previousRequestingNodeGateIndex));
-            } else {
-                if (runningProtocol == RELINK) {
-                    /* if current node is the manager for the randomly generated
-                     * point it ignores this connection
-                     */
-                    int K = (int)par("K");
-                    longLinksCreated++;
-                    EV << "DHTMember: node " << this->getFullName() << " created " << longLinksCreated << "/" << K << " long links." << endl;
-                    if (longLinksCreated < K) {
-                        relink();
-                    } else {
-                        longLinksCreated = 0;
-                    }
-                } else if (runningProtocol == JOIN) {
-                    /* routing procol completed, the node who made the request
-                     * to join the network is inserted between the manager and its
-                     * predecessor
-                     */
-                    DHTMember* joiningMember = addNodeWithSpecificIntervalPosition(request->getX(), getIndex());
-                    joiningMember->calculateNEstimate();
-                }
-            }
-        } else {
-            /* if current node is NOT the manager for randomly generated point */
-            EV << "DHTMember: node " << this->getFullName() << " is NOT the manager for that point. Then current node search for path that minimize distance from randomly generated point." << endl;
+    if (opcode < 0 || opcode >= OPCODES_NUMBER)
+        throw cRuntimeError("DHTMember: received a packet with unknown opcode %d", opcode);
 
-            /* it asks to its neighbours their positions on the unit interval in order to
-             * choose the best path to the manager of that point
-             */
+    /* under the service model packets from other nodes wait for their turn,
+     * self-messages are internal steps of current node and are never queued
+     */
+    if (serviceModelEnabled && !msg->isSelfMessage()) {
+        enqueuePacket(request);
+        return;
+    }
 
-            int reverseGateIndex;
-            randomPoint = request->getX();
-            routinglistSize = request->getRoutingListArraySize();
-            response = request->dup();
-            response->setName("areYouTheManagerOfThisPoint?");
-            response->setX(randomPoint);
-            gateIndexToClosestNode=getBestNeighbourIndex();
-            reverseGateIndex = getReverseGateIndexByGateIndex(gateIndexToClosestNode);
-            response->setRoutingListArraySize(routinglistSize + 1);
-            response->setRoutingList(routinglistSize, reverseGateIndex);
-
-            sendToBestNeighbour(response);
-        }
-    } else if (request->isName("thisIsMyIntervalPositionToFindShortestPath")) {
-        /* a neighbour sent its interval position in order to find shortest path to the manager
-         * of a randomly generated point
-         */
-        EV << "DHTMember: node " << this->getFullName() << " received the interval position of a neighbour in order to calculate shortest path through manager of randomly generated node." << endl;
+    processPacket(request);
+}
 
-        int routinglistSize;
-        double distanceDeltaToPoint;
-        int reverseGateIndex;
+/* hands the packet taken in input to the handler of its opcode */
+void DHTMember::processPacket(Packet* request) {
+    int toSenderGateIndex;
 
-        /* if that neighbour is the closest one (found so far) to the manager of that point
-         * current node remembers the gate that connects itself to it
-         */
-        distanceDeltaToPoint = request->getX() - randomPoint;
-        if (distanceDeltaToPoint < 0)
-            distanceDeltaToPoint += 1;
+    /* replies go back through the gate the request arrived on, input and output
+     * halves of an inout gate share the index. Self-messages and packets sent
+     * directly by a member out of the neighbours have no sender gate
+     */
+    toSenderGateIndex = request->isSelfMessage() || request->arrivedOn("directIn") ? -1 : request->getArrivalGate()->getIndex();
 
-        EV << "DHTMember: distance of point " << randomPoint << " from that neighbour is " << distanceDeltaToPoint << "." << endl;
+    /* a member out of the network drops what its former neighbours still send it and
+     * the internal steps of the session it left. Lookups it was forwarding are lost,
+     * their origins give up on them when they time out
+     */
+    if (churnModel != CHURN_NONE && !isInNetwork() && request->getKind() != JOIN_NETWORK && request->getKind() != LOOKUP_TIMEOUT) {
+        DHT_TRACE << "DHTMember: node " << this->getFullName() << " is out of the network and drops packet " << request->getName() << "." << endl;
+        metrics.packetLost();
+        releasePacket(request);
+        return;
+    }
 
-        if (distanceDeltaToPoint < bestDistanceFoundSoFar) {
-            EV << "DHTMember: that is better than best distance found so far, that is " << bestDistanceFoundSoFar << "." << endl;
-            bestDistanceFoundSoFar = distanceDeltaToPoint;
-            gateIndexToClosestNode = toSenderGateIndex;
-        }
+    requestReused = false;
+    (this->*handlers[request->getKind()])(request, toSenderGateIndex);
 
-        repliesToFindShortestPath++;
+    /* after every request process give received message back to the pool,
+     * unless it was sent again as the response
+     */
+    if (!requestReused)
+        releasePacket(request);
 
-        EV << "DHTMember: node " << this->getFullName() << " received " << repliesToFindShortestPath << "/" << getNeighboursNumber() << " replies." << endl;
+    /* on change mode samples only events that sent packets */
+    if (statisticsMode == STATISTICS_ON_CHANGE && packetsSentByMe != lastCollectedPacketsSentByMe)
+        collectStatistics();
+}
 
-        /* when all neighbours have been considered */
-        if (repliesToFindShortestPath >= getNeighboursNumber()) {
-            /* current node asks to the node on the shortest path if it is the manager
-             * for the randomly generated point it was looking for
-             */
-            EV << "DHTMember: node " << this->getFullName() << " received all the messages from its neighbours, it is now able to find the shortest path to the manager of randomly generated point." << endl;
-
-            routinglistSize = request->getRoutingListArraySize();
-            reverseGateIndex = getReverseGateIndexByGateIndex(gateIndexToClosestNode);
-
-            response = request->dup();
-            response->setName("areYouTheManagerOfThisPoint?");
-            response->setX(randomPoint);
-            response->setRoutingListArraySize(routinglistSize + 1);
-            response->setRoutingList(routinglistSize, reverseGateIndex);
-            packetsSentOverTheNet++; packetsSentByMe++; send(response, "gate$o", gateIndexToClosestNode);
-
-            /* reset protocol variables for next call of relink */
-            bestDistanceFoundSoFar = 42;
-            gateIndexToClosestNode = 0;
-            repliesToFindShortestPath = 0;
-        }
-    } else if (request->isName("areYouTheManagerOfThisPoint?")) {
-        /* current node calculate its segment length in order to decide, in 0.3 simulated
-         * time steps, if it is the manager for randomly generated point
-         */
-        EV << "DHTMember: node " << this->getFullName() << " asks itself if it is the manager of a randomly generated point, to do so it calculates its segment length. This will take 0.3 simulated time steps." << endl;
-        response = request->dup();
-        response->setName("amITheManagerOfThisPoint?");
-        response->setX(request->getX());
-        calculateSegmentLength();
-        scheduleAt(simTime() + 0.3, response);
-    } else if (request->isName("managerIndexIs")) {
-        /* manager for randomly generated point has been found, then it is routed back to
-         * the node who made the request. If there are no remaining nodes to do the routing
-         * it means current node is the one who made the request
-         */
-        EV << "DHTMember: node " << this->getFullName() << " knows that the manager of randomly generated point is " << request->getManager() << ". Routing this information to the node that asked it." << endl;
+/* samples the number of packets sent by current node into its histogram and vector */
+void DHTMember::collectStatistics() {
+    if (DHTMetrics::getNetworkPacketsSent() == 0)
+        return;
 
-        int K;
-        int previousRequestingNodeGateIndex;
-        int routinglistSize;
+    packetsInNetworkHistogram.collect(packetsSentByMe);
+    packetsInNetworkVector.record(packetsSentByMe);
+    lastCollectedPacketsSentByMe = packetsSentByMe;
+}
 
-        K = (int)par("K");
-        routinglistSize = request->getRoutingListArraySize();
-        if (routinglistSize > 0) {
-            EV << "DHTMember: node " << this->getFullName() << " is not the requesting node so it passes the message through a chain to requesting node." << endl;
-            previousRequestingNodeGateIndex = request->getRoutingList(routinglistSize - 1);
-            response = request->dup();
-            response->setName("managerIndexIs");
-            response->setRoutingListArraySize(routinglistSize - 1);
-            packetsSentOverTheNet++; packetsSentByMe++; send(response, gate("gate$o", previousRequestingNodeGateIndex));
-        } else {
-            if (runningProtocol == RELINK) {
-                /* a long link to the manager of the randomly generated point is created,
-                 * relink protocol is called once again if necessary
-                 */
-                EV << "DHTMember: node " << this->getFullName() << " is the requesting node for the manager of randomly generated point so a long link with that manager, that is " << request->getManager() << ", is estabilished." << endl;
-                createLongLinkToMember(request->getManager());
-
-                longLinksCreated++;
-                EV << "DHTMember: node " << this->getFullName() << " created " << longLinksCreated << "/" << K << " long links." << endl;
-                if (longLinksCreated < K) {
-                    relink();
-                } else {
-                    longLinksCreated = 0;
-                }
-            } else if (runningProtocol == JOIN) {
-                /* routing procol completed, the node who made the request
-                 * to join the network is inserted between the manager and its
-                 * predecessor
-                 */
-                DHTMember* joiningMember = addNodeWithSpecificIntervalPosition(request->getX(), request->getManager());
-                joiningMember->calculateNEstimate();
-            }
-        }
-    } else if (request->isName("joinNetwork")) {
-        double randx = uniform(0, 1);
-        int randFriend = intuniform(0, (int)getAncestorPar("connected") - 1);
-        DHTMember* friendOfMine = (DHTMember*)(getParentModule()->getSubmodule("members", randFriend));
+/* converts the statisticsMode parameter to one of the STATISTICS_* modes */
+int DHTMember::getStatisticsModeByName(const char* mode) {
+    if (strcmp(mode, "everyEvent") == 0)
+        return STATISTICS_EVERY_EVENT;
+    if (strcmp(mode, "onChange") == 0)
+        return STATISTICS_ON_CHANGE;
+    if (strcmp(mode, "interval") == 0)
+        return STATISTICS_INTERVAL;
+    if (strcmp(mode, "endOnly") == 0)
+        return STATISTICS_END_ONLY;
+
+    throw cRuntimeError("DHTMember: unknown statistics mode \"%s\", expected everyEvent, onChange, interval or endOnly", mode);
+}
 
-        EV << "DHTMember: node " << this->getFullName() << " want to join the network, then it talks to node " << friendOfMine->getFullName() << ". Interval position for current point is " << randx << "." << endl;
+/* converts the routingDirection parameter to one of the DIRECTION_* modes */
+int DHTMember::getRoutingDirectionByName(const char* direction) {
+    if (strcmp(direction, "clockwise") == 0)
+        return DIRECTION_CLOCKWISE;
+    if (strcmp(direction, "bidirectional") == 0)
+        return DIRECTION_BIDIRECTIONAL;
 
-        x = randx;
-        runningProtocol = JOIN;
-        friendOfMine->routingProtocol(randx, JOIN);
+    throw cRuntimeError("DHTMember: unknown routing direction \"%s\", expected clockwise or bidirectional", direction);
+}
 
-        /* current node will leave network sooner or later */
-        /*simtime_t delay = exponential(10);
-        leave(100.0 * (getIndex() + 1) + delay);*/
-    } else if (request->isName("leaveNetwork")) {
-        response = request->dup();
-        response->setName("youMustRelink");
-        broadcastOnLongLinks(response);
+/* converts the keyDistribution parameter to one of the KEYS_* distributions */
+int DHTMember::getKeyDistributionByName(const char* distribution) {
+    if (strcmp(distribution, "uniform") == 0)
+        return KEYS_UNIFORM;
+    if (strcmp(distribution, "zipf") == 0)
+        return KEYS_ZIPF;
 
-        DHTMember* prev = (DHTMember*)gate("gate$o", 0)->getNextGate()->getOwnerModule();
-        DHTMember* next = (DHTMember*)gate("gate$o", 1)->getNextGate()->getOwnerModule();
+    throw cRuntimeError("DHTMember: unknown key distribution \"%s\", expected uniform or zipf", distribution);
+}
 
-        disconnectGate(gate("gate$o", 0));
-        disconnectGate(gate("gate$o", 1));
+/* converts the queueOverflow parameter to one of the OVERFLOW_* policies */
+int DHTMember::getQueueOverflowByName(const char* policy) {
+    if (strcmp(policy, "reject") == 0)
+        return OVERFLOW_REJECT;
+    if (strcmp(policy, "drop") == 0)
+        return OVERFLOW_DROP;
 
-        prev->gate("gate$o", 1)->connectTo(next->gate("gate$i", 0));
-        next->gate("gate$o", 0)->connectTo(prev->gate("gate$i", 1));
+    throw cRuntimeError("DHTMember: unknown queue overflow policy \"%s\", expected reject or drop", policy);
+}
 
-        /* current node will join the network again sooner or later */
-        simtime_t delay = exponential(10);
-        join(100.0 * (getIndex() + 1) + delay);
-    } else if (request->isName("youMustRelink")) {
-        relink();
-    }
+/* converts the latencyModel parameter to one of the LATENCY_* models */
+int DHTMember::getLatencyModelByName(const char* model) {
+    if (strcmp(model, "fixed") == 0)
+        return LATENCY_FIXED;
+    if (strcmp(model, "coordinates") == 0)
+        return LATENCY_COORDINATES;
 
-    /* after every request process delete received message */
-    delete request;
+    throw cRuntimeError("DHTMember: unknown latency model \"%s\", expected fixed or coordinates", model);
 }
 
-/* ===========================================
- * |             utility methods             |
- * ===========================================
- */
+/* converts the churn parameter to one of the CHURN_* models */
+int DHTMember::getChurnModelByName(const char* model) {
+    if (strcmp(model, "none") == 0)
+        return CHURN_NONE;
+    if (strcmp(model, "exponential") == 0)
+        return CHURN_EXPONENTIAL;
+    if (strcmp(model, "pareto") == 0)
+        return CHURN_PARETO;
 
-/* returns true if current node need to execute the relink
- * procedure after it received a forced update of its estimate
- * for the number of nodes in the network
- */
-bool DHTMember::needToRelink() {
-    double estimateRatio = nEstimate / nEstimateAtLinking;
-    return estimateRatio < 0.5 || estimateRatio > 2;
+    throw cRuntimeError("DHTMember: unknown churn model \"%s\", expected none, exponential or pareto", model);
+}
+
+/* converts the relinkMode parameter to one of the RELINK_* modes */
+int DHTMember::getRelinkModeByName(const char* mode) {
+    if (strcmp(mode, "full") == 0)
+        return RELINK_FULL;
+    if (strcmp(mode, "incremental") == 0)
+        return RELINK_INCREMENTAL;
+
+    throw cRuntimeError("DHTMember: unknown relink mode \"%s\", expected full or incremental", mode);
 }
 
-/* returns the index of the first output gate for current node which is connected
- * to the module taken in input. Returns -1 if no such gate exists
+/* fills the service time of every opcode with the serviceTime parameter, then applies
+ * the overrides of the opcodeServiceTimes parameter, a list of OPCODE=time pairs such
+ * as "MANAGER_QUERY=2ms MANAGER_INDEX=1ms". The service model is enabled if any
+ * opcode takes time
  */
-int DHTMember::getGateToModule(cModule* module) {
+void DHTMember::parseServiceTimes(simtime_t serviceTime, const char* overrides) {
     int i;
-    cGate* nextGate;
-    for (i=0; i<gateSize("gate$o"); i++) {
-        nextGate = gate("gate$o", i)->getNextGate();
-        if (nextGate != NULL && nextGate->getOwnerModule() == module) {
-            return i;
-        }
+    int opcode;
+    const char* token;
+    const char* separator;
+    std::string name;
+    cEnum* opcodes = cEnum::find("Opcode");
+    cStringTokenizer tokenizer(overrides, " ,");
+
+    for (i=0; i<OPCODES_NUMBER; i++)
+        serviceTimes[i] = serviceTime;
+
+    while (tokenizer.hasMoreTokens()) {
+        token = tokenizer.nextToken();
+        separator = strchr(token, '=');
+        if (separator == NULL)
+            throw cRuntimeError("DHTMember: malformed service time \"%s\", expected OPCODE=time", token);
+
+        name = std::string(token, separator - token);
+        opcode = opcodes != NULL ? opcodes->lookup(name.c_str(), -1) : -1;
+        if (opcode < 0 || opcode >= OPCODES_NUMBER)
+            throw cRuntimeError("DHTMember: unknown opcode \"%s\" in service times", name.c_str());
+
+        serviceTimes[opcode] = UnitConversion::parseQuantity(separator + 1, "s");
     }
 
-    return -1;
+    serviceModelEnabled = false;
+    for (i=0; i<OPCODES_NUMBER; i++) {
+        if (serviceTimes[i] > 0)
+            serviceModelEnabled = true;
+    }
 }
 
-/* given the position on the unit interval of the previous node of the current node
- * the length of the segment managed by current node is returned
- */
-double DHTMember::getSegmentLengthByPreviousNodesIntervalPosition(double previousNodeX) {
-    if (previousNodeX < x)
-        return x - previousNodeX;
+/* converts the routing parameter to one of the ROUTING_* modes */
+int DHTMember::getRoutingModeByName(const char* mode) {
+    if (strcmp(mode, "greedy") == 0)
+        return ROUTING_GREEDY;
+    if (strcmp(mode, "lookahead") == 0)
+        return ROUTING_LOOKAHEAD;
 
-    return x + 1.0 - previousNodeX;
+    throw cRuntimeError("DHTMember: unknown routing mode \"%s\", expected greedy or lookahead", mode);
 }
 
-/* returns the number of neighbours of current node */
-int DHTMember::getNeighboursNumber() {
-    int i;
-    int total;
-    total = 0;
-    for (i=0; i<gateSize("gate$o"); i++) {
-        if (hasGate("gate$o", i) && gate("gate$o", i)->isConnected()) {
-            total++;
-        }
-    }
+/* ===========================================
+ * |            protocol handlers            |
+ * ===========================================
+ */
+
+void DHTMember::handleSegmentLengthRequest(Packet* request, int toSenderGateIndex) {
+    Packet* response;
 
-    return total;
+    /* a node asked for current node segment length in order to calculate an estimate of
+     * the number of nodes in the DHT. Segment length is kept up to date on joins and
+     * leaves, then it is sent back at once
+     */
+    DHT_TRACE << "DHTMember: " << request->getSenderModule()->getFullName() << " asked for segment length of " << this->getFullName() << " that is " << segmentLength << ". Sending it back." << endl;
+    response = reuseRequest(request, SEGMENT_LENGTH_REPLY);
+    response->setSegmentLength(segmentLength);
+    sendPacket(response, toSenderGateIndex);
 }
 
-/* returns true if current node is the manager of point p.
- * there are two cases in which current node (A, with its previous node B) is the manager of point p:
- * case 1:
- *      [0      B--x--(A)    1[
- *
- * case 2:
- *      [0--x--(A)     B-----1[
- * or
- *      [0-----(A)     B--x--1[
- */
-bool DHTMember::amIManagerForPoint(double p) {
-    double delta;
-    delta = x - segmentLength;
+void DHTMember::handleSegmentLengthReply(Packet* request, int toSenderGateIndex) {
+    Packet* response;
 
-    if (delta >= 0 && p > delta && p <= x) {
-       return true;
-    }
+    /* the segment length of a neighbour has been received,
+     * sum it up to local partial total
+     */
+    neighboursTotalSegmentsLengths += request->getSegmentLength();
+    /* notify a segment has been received */
+    receivedSegments++;
 
-    if (delta < 0 && (p > 1 + delta || p <= x)) {
-       return true;
-    }
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " received segment length of node " << request->getSenderModule()->getFullName() << " that is " << request->getSegmentLength() << " is now ready. Sending it back." << endl;
+    DHT_TRACE << "DHTMember: received " << receivedSegments << "/2 segment lengths." << endl;
 
-    return false;
-}
+    /* if both segments have been received update current estimate of
+     * the number of nodes in the DHT
+     */
+    if (receivedSegments == 2) {
+        nEstimate = SymphonyRouting::estimateNodes(neighboursTotalSegmentsLengths + segmentLength, 3);
+        neighboursTotalSegmentsLengths = 0;
+        receivedSegments = 0;
 
-void DHTMember::broadcastOnLongLinks(Packet* packet) {
-    int i;
-    cGate* neighbourGate;
-    Packet* packetcp;
-    for (i=2; i<gateSize("gate$o"); i++) {
-        if (hasGate("gate$o", i)) {
-            neighbourGate = gate("gate$o", i);
-            if (neighbourGate->isConnected()) {
-                packetcp = packet->dup();
-                packetsSentOverTheNet++; packetsSentByMe++; send(packetcp, neighbourGate);
-            }
+        DHT_INFO << "DHTMember: both segment were received. Estimate for n is " << nEstimate << "." << endl;
+
+        /* send back calculated estimate to neighbours */
+        int i;
+        for (i=0; i<2; i++) {
+            response = createReply(request, ESTIMATE_UPDATE);
+            response->setNEstimate(nEstimate);
+            sendPacket(response, i);
         }
-    }
-}
 
-/* sends a copy of the message taken in input to every
- * neighbour of current node
- */
-void DHTMember::sendToBestNeighbour(Packet* packet) {
-    bestDistanceFoundSoFar=42;
-    int i;
-    int bestGateIndex=-1;
-    double neighbour_x;
-    double distanceDeltaToPoint;
-    cGate* neighbourGate;
-    for (i=0; i<gateSize("gate$o"); i++) {
-        if (hasGate("gate$o", i)) {
-            neighbourGate = gate("gate$o", i);
-            if (neighbourGate->isConnected()) {
+        DHT_TRACE << "DHTMember: asking neighbours to update their estimates for n to " << nEstimate << "." << endl;
 
-                neighbour_x=((DHTMember*)neighbourGate->getNextGate()->getOwnerModule())->x;
-                distanceDeltaToPoint = neighbour_x - randomPoint;
+        /* start relink procedure on nEstimate update after join */
+        if (runningProtocol == JOIN) {
+            relink(RELINK, simTime());
+        }
+   }
+}
 
-                if (distanceDeltaToPoint < 0)
-                    distanceDeltaToPoint += 1;
+void DHTMember::handleEstimateUpdate(Packet* request, int toSenderGateIndex) {
+    /* a node completed the calculus of an estimate of the number of
+     * nodes in the DHT. It notified to current node that value,
+     * then estimate of the number of nodes in the DHT is updated
+     * for current node too
+     */
+    nEstimate = request->getNEstimate();
 
-                if (distanceDeltaToPoint < bestDistanceFoundSoFar) {
-                    bestDistanceFoundSoFar = distanceDeltaToPoint;
-                    bestGateIndex=i;
+    /* if updated estimate is too old, relink */
+    if (needToRelink())
+        relink(RELINK, simTime());
 
-                }
-            }
-        }
-    }
-    packetsSentOverTheNet++; packetsSentByMe++;
-    EV<<"bestGateIndex:"<<bestGateIndex<<endl;
-    send(packet,"gate$o",bestGateIndex);
+    DHT_TRACE << "DHTMember: " << request->getSenderModule()->getFullName() << " asked to " << this->getFullName() << " to update its estimate for n that is " << request->getNEstimate() << "." << endl;
 }
 
-int DHTMember::getBestNeighbourIndex() {
-    bestDistanceFoundSoFar=42;
-        int i;
-        int bestGateIndex=-1;
-        double neighbour_x;
-        double distanceDeltaToPoint;
-        cGate* neighbourGate;
-        for (i=0; i<gateSize("gate$o"); i++) {
-            if (hasGate("gate$o", i)) {
-                neighbourGate = gate("gate$o", i);
-                if (neighbourGate->isConnected()) {
+void DHTMember::handleManagerCheck(Packet* request, int toSenderGateIndex) {
+    Packet* response;
 
-                    neighbour_x=((DHTMember*)neighbourGate->getNextGate()->getOwnerModule())->x;
-                    distanceDeltaToPoint = neighbour_x - randomPoint;
+    /* current nodes asks itself if it is the manager for
+     * randomly generated point, using its up to date segment length
+     */
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " asks itself if it is the manager for point " << request->getX() << "." << endl;
 
-                    if (distanceDeltaToPoint < 0)
-                        distanceDeltaToPoint += 1;
+    int routinglistSize;
+    int protocol;
+    bool managed;
 
-                    if (distanceDeltaToPoint < bestDistanceFoundSoFar) {
-                        bestDistanceFoundSoFar = distanceDeltaToPoint;
-                        bestGateIndex=i;
+    managed = amIManagerForPoint(request->getX());
+    oracle.managerDecision(request->getX(), getIndex(), managed);
 
-                    }
-                }
-            }
-        }
-        return bestGateIndex;
-}
+    if (managed) {
+        /* if current node is the manager for randomly generated point */
+        DHT_TRACE << "DHTMember: node " << this->getFullName() << " is the manager for that point." << endl;
+        routinglistSize = request->getRoutingListArraySize();
 
-/* returns the index of the output gate of the module connected to current
- * module through the output gate which index is taken in input
- */
-int DHTMember::getReverseGateIndexByGateIndex(int index) {
-    cGate* fromGate;
-    cModule* nextGateModule;
-    DHTMember* nextGateDHTModule;
+        /* every forwarding hop pushed one gate index, then the routing list
+         * holds as many indices as the hops the lookup took to get here
+         */
+        request->setLookupHops(routinglistSize);
 
-    fromGate = gate("gate$o", index);
-    nextGateModule = fromGate->getNextGate()->getOwnerModule();
-    nextGateDHTModule = (DHTMember*)nextGateModule;
+        /* nodes the answer passes through cache the segment of current node */
+        request->setManagerX(x);
+        request->setManagerSegmentLength(segmentLength);
 
-    return nextGateDHTModule->getGateToModule(this);
-}
+        /* storage operations are executed by the manager, their result goes
+         * back to the requesting node together with the manager index
+         */
+        executeStorageOperation(request);
 
-/* returns true if current node has got any unconnected gate */
-bool DHTMember::hasAvailableConnections() {
-    int i;
-    for (i=0; i<gateSize("gate$o"); i++) {
-        if (hasGate("gate$o", i) && !gate("gate$o", i)->isConnected()) {
-            return true;
-        }
-    }
-    return false;
-}
+        if (routinglistSize > 0) {
+            /* if information about the manager have not been transmitted
+             * to the node who made the request for it
+             */
+            DHT_TRACE << "DHTMember: node " << this->getFullName() << " is not the requesting node so it passes backwards the message deleting itself from routing list." << endl;
 
-/* returns true if current node is already connected to DHTMember member */
-bool DHTMember::alreadyConnected(DHTMember* member) {
-    int i;
-    cGate* neighbourGate;
-    for (i=0; i<gateSize("gate$o"); i++) {
-        if (hasGate("gate$o", i)) {
-            neighbourGate = gate("gate$o", i);
-            if (neighbourGate->isConnected() && neighbourGate->getNextGate()->getOwnerModule() == member) {
-                return true;
+            /* current node passes backwards its message along requesting chain (routing list) */
+            response = reuseRequest(request, MANAGER_INDEX);
+            response->setManager(getIndex());
+            sendBackAlongRoutingList(response);
+        } else {
+            protocol = lookupCompleted(request);
+            if (protocol == RELINK || protocol == REPAIR) {
+                /* if current node is the manager for the randomly generated
+                 * point it ignores this connection
+                 */
+                relinkLookupCompleted();
+            } else if (protocol == JOIN) {
+                /* routing procol completed, the node who made the request
+                 * to join the network is inserted between the manager and its
+                 * predecessor
+                 */
+                DHTMember* joiningMember = addJoiningMember(request->getJoiningMember(), getIndex());
+                joiningMember->calculateNEstimate();
+            } else if (protocol == PUT || protocol == GET) {
+                storageOperationCompleted(request, protocol);
             }
         }
-    }
-    return false;
-}
+    } else {
+        /* if current node is NOT the manager for randomly generated point */
+        DHT_TRACE << "DHTMember: node " << this->getFullName() << " is NOT the manager for that point. Then current node search for path that minimize distance from randomly generated point." << endl;
 
-/* returns last connected gate for current node over gate vector gateRef,
- * this method returns NULL if all gates of that gate vector are unconnected
- */
-cGate* DHTMember::getLastConnectedGate(const char* gateRef) {
-    int i;
-    for (i=gateSize(gateRef)-1; i>2; i--) {
-        if (hasGate(gateRef, i) && gate(gateRef, i)->isConnected()) {
-            return gate(gateRef, i);
-        }
+        /* a manager recently discovered for that point saves the routing */
+        if (routeByManagerCache(request))
+            return;
+
+        /* the answer will come back through current node */
+        metrics.lookupForwarded();
+
+        /* it forwards the lookup to the neighbour on the best path to the manager
+         * of that point
+         */
+        response = reuseRequest(request, MANAGER_QUERY);
+        sendToBestNeighbour(response);
     }
-    return NULL;
 }
 
-/* returns first unconnected gate for current node over gate vector gateRef,
- * this method returns NULL if all gates of that gate vector are connected
- */
-cGate* DHTMember::getFirstUnconnectedGate(const char* gateRef) {
-    int i;
-    cGate* neighbourGate;
-    for (i=0; i<gateSize(gateRef); i++) {
-        if (hasGate(gateRef, i)) {
-            neighbourGate = gate(gateRef, i);
-            if (!neighbourGate->isConnected()) {
-                return neighbourGate;
-            }
-        }
-    }
-    return NULL;
+void DHTMember::handleManagerQuery(Packet* request, int toSenderGateIndex) {
+    /* current node knows its segment length at any time, then it decides
+     * at once if it is the manager for randomly generated point
+     */
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " was asked if it is the manager of a randomly generated point." << endl;
+    handleManagerCheck(request, toSenderGateIndex);
 }
 
-/* this method creates a link from current node to the node which member is
- * taken in input using the first unconnected gate for current node */
+void DHTMember::handleManagerIndex(Packet* request, int toSenderGateIndex) {
+    Packet* response;
+
+    /* manager for randomly generated point has been found, then it is routed back to
+     * the node who made the request. If there are no remaining nodes to do the routing
+     * it means current node is the one who made the request
+     */
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " knows that the manager of randomly generated point is " << request->getManager() << ". Routing this information to the node that asked it." << endl;
+
+    int routinglistSize;
+    int protocol;
+
+    metrics.lookupReturned();
+
+    /* the manager advertised its segment, rejected lookups carry none */
+    if (request->getManagerSegmentLength() > 0)
+        managerCache.insert(request->getManagerX() - request->getManagerSegmentLength(), request->getManagerX(), request->getManager());
+
+    routinglistSize = request->getRoutingListArraySize();
+    if (routinglistSize > 0) {
+        DHT_TRACE << "DHTMember: node " << this->getFullName() << " is not the requesting node so it passes the message through a chain to requesting node." << endl;
+        response = reuseRequest(request, MANAGER_INDEX);
+        sendBackAlongRoutingList(response);
+    } else {
+        protocol = lookupCompleted(request);
+
+        /* under churn the manager a join lookup found may leave before the answer is back */
+        if (request->getManager() == NO_MANAGER || (protocol == JOIN && !getMember(request->getManager())->isInNetwork())) {
+            lookupRejected(request, protocol);
+        } else if (protocol == RELINK || protocol == REPAIR) {
+            /* a long link to the manager of the randomly generated point is created */
+            DHT_INFO << "DHTMember: node " << this->getFullName() << " is the requesting node for the manager of randomly generated point so a long link with that manager, that is " << request->getManager() << ", is estabilished." << endl;
+            createLongLinkToMember(request->getManager(), request->getX());
+            relinkLookupCompleted();
+        } else if (protocol == JOIN) {
+            /* routing procol completed, the node who made the request
+             * to join the network is inserted between the manager and its
+             * predecessor
+             */
+            DHTMember* joiningMember = addJoiningMember(request->getJoiningMember(), request->getManager());
+            joiningMember->calculateNEstimate();
+        } else if (protocol == PUT || protocol == GET) {
+            storageOperationCompleted(request, protocol);
+        }
+    }
+}
+
+void DHTMember::handleJoinNetwork(Packet* request, int toSenderGateIndex) {
+    double randx = uniform(0, 1);
+    int randFriend;
+    DHTMember* friendOfMine;
+
+    /* under churn members of the initial ring may be out of the network, a member in
+     * the network is taken at random as a bootstrap server would
+     */
+    if (churnModel == CHURN_NONE) {
+        randFriend = intuniform(0, (int)getAncestorPar("connected") - 1);
+    } else {
+        if (networkMembers.empty()) {
+            DHT_INFO << "DHTMember: node " << this->getFullName() << " finds no member in the network, it will try again later." << endl;
+            join(exponential(SIMTIME_DBL(downtime)));
+            return;
+        }
+        randFriend = networkMembers[intuniform(0, (int)networkMembers.size() - 1)];
+    }
+    friendOfMine = getMember(randFriend);
+
+    DHT_INFO << "DHTMember: node " << this->getFullName() << " want to join the network, then it talks to node " << friendOfMine->getFullName() << ". Interval position for current point is " << randx << "." << endl;
+
+    x = randx;
+    updateSegmentLength();
+    refreshPositionInNeighbourTables();
+    runningProtocol = JOIN;
+    friendOfMine->joinLookup(randx, getIndex());
+}
+
+void DHTMember::handleLeaveNetwork(Packet* request, int toSenderGateIndex) {
+    Packet* response;
+
+    metrics.memberLeft();
+
+    /* long linked neighbours look up their lost links again, the time they take
+     * runs from the departure
+     */
+    response = reuseRequest(request, RELINK_REQUEST);
+    response->setProtocol(REPAIR);
+    response->setLookupStart(simTime());
+    broadcastOnLongLinks(response);
+    dropAllLongLinks();
+
+    DHTMember* prev = neighbours[0].member;
+    DHTMember* next = neighbours[1].member;
+
+    /* cached segments around current node are out of date */
+    invalidateManagerCaches(x);
+    oracle.memberLeft(x, getIndex());
+
+    /* the last member in networkMembers takes the slot of current node */
+    networkMembers[networkMembersSlot] = networkMembers.back();
+    getMember(networkMembers.back())->networkMembersSlot = networkMembersSlot;
+    networkMembers.pop_back();
+    networkMembersSlot = -1;
+
+    /* the successor of current node manages its segment from now on,
+     * then it takes every key current node was storing
+     */
+    metrics.keysMoved(keys.moveAllKeysTo(next->keys));
+    DHT_INFO << "DHTMember: node " << this->getFullName() << " leaves the network, its keys are handed to node " << next->getFullName() << "." << endl;
+
+    disconnectGate(0);
+    disconnectGate(1);
+
+    prev->connectGate(1, next, 0);
+
+    /* the successor takes the segment of current node within the leave */
+    next->updateSegmentLength(prev->x);
+
+    /* the running relink and estimate are given up, answers to relink lookups of the
+     * session current node left are ignored when they come back
+     */
+    session++;
+    relinkLookupsPending = 0;
+    longLinksCreated = 0;
+    repairPending = false;
+    neighboursTotalSegmentsLengths = 0;
+    receivedSegments = 0;
+    managerCache.clear();
+
+    /* current node will join the network again after its downtime */
+    join(exponential(SIMTIME_DBL(downtime)));
+}
+
+void DHTMember::handleRelinkRequest(Packet* request, int toSenderGateIndex) {
+    /* the running relink may have linked the departed node already or, when
+     * incremental, kept the link to it, the repair waits for the relink to complete
+     */
+    if (relinkLookupsPending > 0) {
+        if (!repairPending) {
+            repairPending = true;
+            repairDeparture = request->getLookupStart();
+        }
+        return;
+    }
+
+    relink(REPAIR, request->getLookupStart());
+}
+
+void DHTMember::handleLookupTimeout(Packet* request, int toSenderGateIndex) {
+    LookupState* lookup;
+    int protocol;
+    bool abandoned;
+
+    /* the answer came back in time */
+    lookup = pendingLookups.find(request->getLookupId());
+    if (lookup == NULL)
+        return;
+
+    protocol = lookup->protocol;
+    abandoned = lookup->session != session && (protocol == RELINK || protocol == REPAIR);
+    pendingLookups.remove(request->getLookupId());
+
+    /* current node left the network after it started this relink lookup */
+    if (abandoned)
+        return;
+
+    DHT_INFO << "DHTMember: node " << this->getFullName() << " gave up " << DHTMetrics::getLookupProtocolName(protocol) << " lookup #" << request->getLookupId() << " after " << lookupTimeout << "s." << endl;
+    metrics.lookupFailed(protocol);
+    lookupRejected(request, protocol);
+}
+
+/* ===========================================
+ * |             utility methods             |
+ * ===========================================
+ */
+
+/* returns an empty packet for the protocol opcode taken in input */
+Packet* DHTMember::createPacket(int opcode) {
+    Packet* packet = acquirePacket();
+    packet->setKind(opcode);
+    packet->setName(getOpcodeLabel(opcode));
+    packet->setX(0);
+    packet->setSegmentLength(0);
+    packet->setNEstimate(0);
+    packet->clearRoutingList();
+    packet->setManager(0);
+    packet->setLookupId(0);
+    packet->setLookupStart(0);
+    packet->setLookupHops(0);
+    packet->setProtocol(NONE);
+    packet->setKey(0);
+    packet->setValue(0);
+    packet->setFound(false);
+    packet->setManagerX(0);
+    packet->setManagerSegmentLength(0);
+    packet->setJoiningMember(NONE);
+    return packet;
+}
+
+/* returns a copy of the request taken in input, turned into a packet
+ * for the protocol opcode taken in input
+ */
+Packet* DHTMember::createReply(Packet* request, int opcode) {
+    Packet* reply = acquirePacket();
+    *reply = *request;
+    reply->setKind(opcode);
+    reply->setName(getOpcodeLabel(opcode));
+    return reply;
+}
+
+/* turns the request taken in input into a packet for the protocol opcode
+ * taken in input, so that it can be sent again without copying it.
+ * The request will not be given back to the pool after it has been handled
+ */
+Packet* DHTMember::reuseRequest(Packet* request, int opcode) {
+    request->setKind(opcode);
+    request->setName(getOpcodeLabel(opcode));
+    requestReused = true;
+    return request;
+}
+
+/* returns a packet taken from the packet pool, a new packet
+ * is allocated only if the pool is empty
+ */
+Packet* DHTMember::acquirePacket() {
+    Packet* packet;
+
+    if (packetPool.empty()) {
+        packetPoolMisses++;
+        return new Packet();
+    }
+
+    packetPoolHits++;
+    packet = packetPool.back();
+    packetPool.pop_back();
+
+    /* pooled packets stay owned by the member that released them */
+    if (packet->getOwner() != this)
+        take(packet);
+
+    return packet;
+}
+
+/* sends the packet taken in input through the output gate which index is taken
+ * in input, accounting it in traffic metrics of current node
+ */
+void DHTMember::sendPacket(Packet* packet, int gateIndex) {
+    /* under churn the link a packet is routed back through may be gone with a departed node */
+    if (churnModel != CHURN_NONE && (gateIndex < 0 || neighbours[gateIndex].member == NULL)) {
+        DHT_TRACE << "DHTMember: node " << this->getFullName() << " has no link through gate " << gateIndex << ", packet " << packet->getName() << " is lost." << endl;
+        metrics.packetLost();
+        releasePacket(packet);
+        return;
+    }
+
+    sendPacket(packet, neighbours[gateIndex].outGate);
+}
+
+/* sends the packet taken in input through the output gate taken in input,
+ * accounting it in traffic metrics of current node
+ */
+void DHTMember::sendPacket(Packet* packet, cGate* outGate) {
+    cChannel* channel = outGate->getChannel();
+
+    packet->setByteLength(getPacketBytes(packet));
+    packetsSentByMe++;
+    metrics.packetSent(packet);
+
+    /* a link still transmitting earlier packets queues the new one behind them */
+    if (channel != NULL && channel->isTransmissionChannel() && channel->getTransmissionFinishTime() > simTime())
+        sendDelayed(packet, channel->getTransmissionFinishTime() - simTime(), outGate);
+    else
+        send(packet, outGate);
+}
+
+/* sends the packet taken in input straight to the member taken in input, out of the
+ * overlay links, accounting it in traffic metrics of current node. It takes the delay
+ * a link between the two members would have
+ */
+void DHTMember::sendPacketDirect(Packet* packet, DHTMember* member) {
+    packet->setByteLength(getPacketBytes(packet));
+    packetsSentByMe++;
+    metrics.packetSent(packet);
+
+    sendDirect(packet, getLinkDelay(member), 0, member->gate("directIn"));
+}
+
+/* sends the answer taken in input one step back along its routing list, through the
+ * gate on top of it or directly to the member that took a direct hop
+ */
+void DHTMember::sendBackAlongRoutingList(Packet* packet) {
+    int entry = packet->popRoutingList();
+
+    if (entry >= 0)
+        sendPacket(packet, entry);
+    else
+        sendPacketDirect(packet, getMember(DIRECT_HOP(entry)));
+}
+
+/* returns the size in bytes of the packet taken in input: header, payload of its
+ * opcode, routing list and the value it carries, if any
+ */
+int DHTMember::getPacketBytes(Packet* packet) {
+    int bytes = PACKET_HEADER_BYTES + opcodeBytes[packet->getKind()];
+
+    bytes += ROUTING_LIST_ENTRY_BYTES * packet->getRoutingListArraySize();
+    if (packet->getKind() == MANAGER_INDEX) {
+        if (packet->getProtocol() == GET && packet->getFound())
+            bytes += valueBytes;
+    } else if (packet->getProtocol() == PUT) {
+        bytes += valueBytes;
+    }
+
+    return bytes;
+}
+
+/* returns the propagation delay of a link between current node and the member
+ * taken in input, under the latency model of current node
+ */
+simtime_t DHTMember::getLinkDelay(DHTMember* member) {
+    double dx;
+    double dy;
+
+    if (latencyModel == LATENCY_FIXED)
+        return linkDelay;
+
+    dx = coordX - member->coordX;
+    dy = coordY - member->coordY;
+    return minLinkDelay + linkDelay * sqrt(dx * dx + dy * dy);
+}
+
+/* sets delay and datarate of the channel taken in input, that carries packets
+ * from current node to the member taken in input
+ */
+void DHTMember::configureLinkChannel(cDatarateChannel* channel, DHTMember* member) {
+    channel->setDelay(SIMTIME_DBL(getLinkDelay(member)));
+    channel->setDatarate(linkDatarate);
+}
+
+/* gives back to the packet pool a packet that will not be sent anymore */
+void DHTMember::releasePacket(Packet* packet) {
+    packetPool.push_back(packet);
+}
+
+/* returns the debug label for the opcode taken in input. Labels are attached
+ * to packets only in graphical runs, batch runs dispatch nameless packets
+ */
+const char* DHTMember::getOpcodeLabel(int opcode) {
+    return ev.isGUI() ? opcodeLabels[opcode] : NULL;
+}
+
+/* returns true if current node need to execute the relink
+ * procedure after it received a forced update of its estimate
+ * for the number of nodes in the network
+ */
+bool DHTMember::needToRelink() {
+    return SymphonyRouting::needToRelink(nEstimate, nEstimateAtLinking);
+}
+
+/* given the position on the unit interval of the previous node of the current node
+ * the length of the segment managed by current node is returned
+ */
+double DHTMember::getSegmentLengthByPreviousNodesIntervalPosition(double previousNodeX) {
+    return SymphonyRouting::getSegmentLength(previousNodeX, x);
+}
+
+/* returns the number of neighbours of current node */
+int DHTMember::getNeighboursNumber() {
+    return neighboursNumber;
+}
+
+/* returns true if current node is the manager of point p.
+ * there are two cases in which current node (A, with its previous node B) is the manager of point p:
+ * case 1:
+ *      [0      B--x--(A)    1[
+ *
+ * case 2:
+ *      [0--x--(A)     B-----1[
+ * or
+ *      [0-----(A)     B--x--1[
+ */
+bool DHTMember::amIManagerForPoint(double p) {
+    return SymphonyRouting::isManagerOfPoint(x, segmentLength, p);
+}
+
+/* sends the message taken in input to every long linked neighbour
+ * of current node, the last one receives the message itself
+ */
+void DHTMember::broadcastOnLongLinks(Packet* packet) {
+    int i;
+    cGate* lastNeighbourGate;
+    lastNeighbourGate = NULL;
+    for (i=2; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL) {
+            if (lastNeighbourGate != NULL) {
+                sendPacket(createReply(packet, packet->getKind()), lastNeighbourGate);
+            }
+            lastNeighbourGate = neighbours[i].outGate;
+        }
+    }
+
+    if (lastNeighbourGate != NULL) {
+        sendPacket(packet, lastNeighbourGate);
+    } else {
+        releasePacket(packet);
+    }
+}
+
+/* sends the lookup packet taken in input to the neighbour it has to be forwarded
+ * to, see getBestNeighbourIndex(). The reverse gate of that link is pushed on the
+ * routing list, the answer comes back through it
+ */
+void DHTMember::sendToBestNeighbour(Packet* packet) {
+    int bestGateIndex;
+
+    bestGateIndex = getBestNeighbourIndex(packet->getX());
+    packet->pushRoutingList(getReverseGateIndexByGateIndex(bestGateIndex));
+    sendPacket(packet, bestGateIndex);
+}
+
+/* returns the index of the gate to the neighbour a lookup for the point taken in input
+ * has to be forwarded to. In greedy mode that is the neighbour closest to the point, in
+ * lookahead mode the neighbour that is, or is connected to, the node closest to the point
+ */
+int DHTMember::getBestNeighbourIndex(double point) {
+    double bestDistance=42; /* note: every number >= than 1 could be considered +infinity */
+    int i;
+    unsigned int j;
+    int bestGateIndex=-1;
+    double distanceDeltaToPoint;
+    double neighbourDistance;
+    double lookaheadDistance;
+    double bestNeighbourDistance=42;
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL) {
+            neighbourDistance = getDistanceToPoint(neighbours[i].x, point);
+            distanceDeltaToPoint = neighbourDistance;
+
+            if (routingMode == ROUTING_LOOKAHEAD) {
+                /* current node is in every list, it is not a valid second hop */
+                for (j=0; j<neighbours[i].neighbourPositions.size(); j++) {
+                    if (neighbours[i].neighbourPositions[j] == x)
+                        continue;
+
+                    lookaheadDistance = getDistanceToPoint(neighbours[i].neighbourPositions[j], point);
+                    if (lookaheadDistance < distanceDeltaToPoint)
+                        distanceDeltaToPoint = lookaheadDistance;
+                }
+            }
+
+            /* neighbours reaching the same node tie, the closest one of them goes on,
+             * otherwise two of them could hand the lookup back and forth
+             */
+            if (distanceDeltaToPoint < bestDistance || (distanceDeltaToPoint == bestDistance && neighbourDistance < bestNeighbourDistance)) {
+                bestDistance = distanceDeltaToPoint;
+                bestNeighbourDistance = neighbourDistance;
+                bestGateIndex=i;
+            }
+        }
+    }
+
+    /* no neighbour is closer than current node, that precedes the point:
+     * its successor is the manager
+     */
+    if (SymphonyRouting::successorIsManager(bestDistance, x, point, routingDirection == DIRECTION_BIDIRECTIONAL))
+        bestGateIndex = 1;
+
+    return bestGateIndex;
+}
+
+/* returns the distance of the point taken in input from the position taken in input.
+ * Going clockwise only, the point is reached by its manager, the first node after it.
+ * Going both ways, it is the shortest way around the unit interval
+ */
+double DHTMember::getDistanceToPoint(double position, double point) {
+    return SymphonyRouting::getDistanceToPoint(position, point, routingDirection == DIRECTION_BIDIRECTIONAL);
+}
+
+/* in lookahead routing mode copies the positions of current node neighbours into the
+ * neighbour tables of each of them. Called whenever a link of current node is created
+ * or dropped, so that lists are exchanged at link time and on relink
+ */
+void DHTMember::publishNeighbourPositions() {
+    int i;
+    std::vector<double> positions;
+
+    if (routingMode != ROUTING_LOOKAHEAD)
+        return;
+
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL)
+            positions.push_back(neighbours[i].x);
+    }
+
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL)
+            neighbours[i].member->neighbours[neighbours[i].reverseGateIndex].neighbourPositions = positions;
+    }
+}
+
+/* returns the index of the output gate of the module connected to current
+ * module through the output gate which index is taken in input
+ */
+int DHTMember::getReverseGateIndexByGateIndex(int index) {
+    return neighbours[index].reverseGateIndex;
+}
+
+/* returns true if current node has got any unconnected gate */
+bool DHTMember::hasAvailableConnections() {
+    return neighboursNumber < (int)neighbours.size();
+}
+
+/* returns true if current node is already connected to DHTMember member */
+bool DHTMember::alreadyConnected(DHTMember* member) {
+    int i;
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member == member) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* returns the index of the last connected long link gate for current node,
+ * this method returns -1 if all those gates are unconnected
+ */
+int DHTMember::getLastConnectedGateIndex() {
+    int i;
+    for (i=neighbours.size()-1; i>2; i--) {
+        if (neighbours[i].member != NULL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* returns the index of the first retiring long link of current node, -1 if none */
+int DHTMember::getRetiringGateIndex() {
+    int i;
+    for (i=2; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL && neighbours[i].retiring)
+            return i;
+    }
+    return -1;
+}
+
+/* returns the number of long links of current node, drawn by it or by the other end */
+int DHTMember::getLongLinksNumber() {
+    int i;
+    int longLinks = 0;
+    for (i=2; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL)
+            longLinks++;
+    }
+    return longLinks;
+}
+
+/* returns the index of the first unconnected gate for current node,
+ * this method returns -1 if all gates are connected
+ */
+int DHTMember::getFirstUnconnectedGateIndex() {
+    int i;
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member == NULL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* this method creates a link from current node to the node which member is
+ * taken in input using the first unconnected gate for current node */
 void DHTMember::createLongLinkByFirstUnconnectedGate(DHTMember* member) {
-    cGate* currentFirstUnconnectedGateIn;
-    cGate* currentFirstUnconnectedGateOut;
-    cGate* memberFirstUnconnectedGateIn;
-    cGate* memberFirstUnconnectedGateOut;
+    connectGate(getFirstUnconnectedGateIndex(), member, member->getFirstUnconnectedGateIndex());
+}
 
-    currentFirstUnconnectedGateIn  = getFirstUnconnectedGate("gate$i");
-    currentFirstUnconnectedGateOut = getFirstUnconnectedGate("gate$o");
+/* connects gate gateIndex of current node to gate memberGateIndex of member,
+ * in both directions, updating the neighbour tables of both nodes
+ */
+void DHTMember::connectGate(int gateIndex, DHTMember* member, int memberGateIndex) {
+    cDatarateChannel* channel;
+    cDatarateChannel* memberChannel;
 
-    memberFirstUnconnectedGateIn  = member->getFirstUnconnectedGate("gate$i");
-    memberFirstUnconnectedGateOut = member->getFirstUnconnectedGate("gate$o");
+    /* links created at runtime get the same link model of links declared in package.ned */
+    channel = cDatarateChannel::create("channel");
+    configureLinkChannel(channel, member);
+    memberChannel = cDatarateChannel::create("channel");
+    member->configureLinkChannel(memberChannel, this);
 
-    /* connect current node to member */
-    currentFirstUnconnectedGateOut->connectTo(memberFirstUnconnectedGateIn);
-    memberFirstUnconnectedGateOut->connectTo(currentFirstUnconnectedGateIn);
+    neighbours[gateIndex].outGate->connectTo(member->gate("gate$i", memberGateIndex), channel);
+    member->neighbours[memberGateIndex].outGate->connectTo(gate("gate$i", gateIndex), memberChannel);
+
+    setNeighbour(gateIndex, member, memberGateIndex);
+    member->setNeighbour(memberGateIndex, this, gateIndex);
+
+    publishNeighbourPositions();
+    member->publishNeighbourPositions();
+}
+
+/* drops the link of current node through gate gateIndex, in both directions,
+ * updating the neighbour tables of both nodes
+ */
+void DHTMember::disconnectGate(int gateIndex) {
+    DHTMember* member;
+    int memberGateIndex;
+
+    member = neighbours[gateIndex].member;
+    memberGateIndex = neighbours[gateIndex].reverseGateIndex;
+
+    member->neighbours[memberGateIndex].outGate->disconnect();
+    neighbours[gateIndex].outGate->disconnect();
+
+    member->clearNeighbour(memberGateIndex);
+    clearNeighbour(gateIndex);
+
+    publishNeighbourPositions();
+    member->publishNeighbourPositions();
 }
 
-void DHTMember::disconnectGate(cGate* toDisconnect) {
-    int neighbourGateIndexToCurrentNode;
-    cGate* neighbourGateToCurrentNode;
+/* records in the neighbour table of current node that member is connected
+ * through gate gateIndex, and that member reaches current node through
+ * its gate reverseGateIndex
+ */
+void DHTMember::setNeighbour(int gateIndex, DHTMember* member, int reverseGateIndex) {
+    if (neighbours[gateIndex].member == NULL)
+        neighboursNumber++;
+
+    neighbours[gateIndex].member = member;
+    neighbours[gateIndex].x = member->x;
+    neighbours[gateIndex].reverseGateIndex = reverseGateIndex;
+    neighbours[gateIndex].linkLength = LENGTH_UNKNOWN;
+    neighbours[gateIndex].retiring = false;
+
+    if (gateIndex == 0)
+        updateSegmentLength();
+    if (gateIndex >= 2)
+        metrics.longLinksChanged(getLongLinksNumber());
+}
+
+/* records in the neighbour table of current node that gate gateIndex is unconnected */
+void DHTMember::clearNeighbour(int gateIndex) {
+    if (neighbours[gateIndex].member != NULL)
+        neighboursNumber--;
+
+    neighbours[gateIndex].member = NULL;
+    neighbours[gateIndex].reverseGateIndex = -1;
+    neighbours[gateIndex].linkLength = LENGTH_UNKNOWN;
+    neighbours[gateIndex].retiring = false;
+    neighbours[gateIndex].neighbourPositions.clear();
 
-    neighbourGateIndexToCurrentNode = getReverseGateIndexByGateIndex(toDisconnect->getIndex());
-    neighbourGateToCurrentNode = toDisconnect->getNextGate()->getOwnerModule()->gate("gate$o", neighbourGateIndexToCurrentNode);
+    if (gateIndex >= 2)
+        metrics.longLinksChanged(getLongLinksNumber());
+}
 
-    neighbourGateToCurrentNode->disconnect();
-    toDisconnect->disconnect();
+/* updates the interval position of current node in the neighbour
+ * tables of the nodes it is still connected to
+ */
+void DHTMember::refreshPositionInNeighbourTables() {
+    int i;
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL) {
+            neighbours[i].member->neighbours[neighbours[i].reverseGateIndex].x = x;
+            neighbours[i].member->updateSegmentLength();
+            neighbours[i].member->publishNeighbourPositions();
+        }
+    }
 }
 
 void DHTMember::dropAllLongLinks() {
     int i;
-    for (i=2; i<gateSize("gate$o"); i++) {
-        if (hasGate("gate$o", i) && gate("gate$o", i)->isConnected()) {
-            disconnectGate(gate("gate$o", i));
+    for (i=2; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL) {
+            disconnectGate(i);
         }
     }
 }
@@ -738,55 +1726,73 @@ void DHTMember::dropAllLongLinks() {
  * connects it to the node which member is taken in input
  */
 void DHTMember::createLongLinkDisconnectingLastConnectedGate(DHTMember* member) {
-    cGate* lastConnectedGate;
-    cGate* memberFirstUnconnectedGateIn;
-    cGate* memberFirstUnconnectedGateOut;
+    int lastConnectedGateIndex;
 
     /* disconnect last long link for current node */
-    lastConnectedGate = getLastConnectedGate("gate$o");
-    disconnectGate(lastConnectedGate);
+    lastConnectedGateIndex = getLastConnectedGateIndex();
+    disconnectGate(lastConnectedGateIndex);
 
     /* connect current node to member */
-    memberFirstUnconnectedGateIn  = member->getFirstUnconnectedGate("gate$i");
-    memberFirstUnconnectedGateOut = member->getFirstUnconnectedGate("gate$o");
+    connectGate(lastConnectedGateIndex, member, member->getFirstUnconnectedGateIndex());
+}
 
-    lastConnectedGate->connectTo(memberFirstUnconnectedGateIn);
-    memberFirstUnconnectedGateOut->connectTo(gate("gate$i", lastConnectedGate->getIndex()));
+/* this method disconnects the retiring long link of current node connected through
+ * the gate which index is taken in input and connects that gate to the node which
+ * member is taken in input, so that current node never has one long link less
+ */
+void DHTMember::createLongLinkSwappingGate(int gateIndex, DHTMember* member) {
+    disconnectGate(gateIndex);
+    connectGate(gateIndex, member, member->getFirstUnconnectedGateIndex());
 }
 
 /* if necessary creates a long link to node which index is taken in input,
  * a link is not created if another link to that node yet exists, that node
  * is current node itself or that node has not any connection left
  */
-void DHTMember::createLongLinkToMember(int index) {
+void DHTMember::createLongLinkToMember(int index, double length) {
+    int i;
     int K;
+    int retiringGateIndex;
     DHTMember* manager;
 
     K = (int)par("K");
     manager = (DHTMember*)(getParentModule()->getSubmodule("members", index));
 
-    EV << "DHTMember: node " << this->getFullName() << " checks for manager identity." << endl;
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " checks for manager identity." << endl;
 
-    /* if manager has got at least one unconnected gate */
-    if (manager->hasAvailableConnections() && !alreadyConnected(manager) && manager != this) {
-        EV << "DHTMember: manager has got available connections, is not already connected to current node and is not the current node." << endl;
+    /* if manager has got at least one unconnected gate and, under churn, did not leave */
+    if (manager->isInNetwork() && manager->hasAvailableConnections() && !alreadyConnected(manager) && manager != this) {
+        DHT_TRACE << "DHTMember: manager has got available connections, is not already connected to current node and is not the current node." << endl;
 
-        if (getNeighboursNumber() < 2 + K) {
-            EV << "DHTMember: node " << this->getFullName() << " has got less than " << (2 + K) << " connections, then it connects through the first unconnected gate it has got." << endl;
+        retiringGateIndex = getRetiringGateIndex();
+        if (retiringGateIndex >= 0) {
+            DHT_TRACE << "DHTMember: node " << this->getFullName() << " swaps its retiring long link through gate " << retiringGateIndex << " for the new one." << endl;
+            /* an incremental relink replaces a long link that is no longer a
+             * harmonic sample only once its replacement is found
+             */
+            createLongLinkSwappingGate(retiringGateIndex, manager);
+        } else if (getNeighboursNumber() < 2 + K) {
+            DHT_TRACE << "DHTMember: node " << this->getFullName() << " has got less than " << (2 + K) << " connections, then it connects through the first unconnected gate it has got." << endl;
             /* if current node has got at least one unconnected gate
              * then connect that gate to manager's first unconnected gate
              */
             createLongLinkByFirstUnconnectedGate(manager);
         } else {
-            EV << "DHTMember: node " << this->getFullName() << " has got more than " << (2 + K) << " connections, then it drops one long distance connection and relinks to manager." << endl;
+            DHT_INFO << "DHTMember: node " << this->getFullName() << " has got more than " << (2 + K) << " connections, then it drops one long distance connection and relinks to manager." << endl;
             /* otherwise, current node has not got any unconnected gate,
              * disconnect its last connected gate and use that gate to connect
              * itself to manager
              */
             createLongLinkDisconnectingLastConnectedGate(manager);
         }
+
+        /* current node drew this link, incremental relinks judge it by its length */
+        for (i=2; i<(int)neighbours.size(); i++) {
+            if (neighbours[i].member == manager)
+                neighbours[i].linkLength = length;
+        }
     } else {
-        EV << "DHTMember: manager has not got available connections, is already connected to current node or it is the current node itself. Thus the long link connection is NOT estabilished." << endl;
+        DHT_TRACE << "DHTMember: manager has not got available connections, is already connected to current node or it is the current node itself. Thus the long link connection is NOT estabilished." << endl;
     }
 }
 
@@ -795,9 +1801,22 @@ void DHTMember::createLongLinkToMember(int index) {
  * ===========================================
  */
 
-void DHTMember::calculateSegmentLength() {
-    Packet* request = new Packet("needYourIntervalPositionToCalculateMySegmentLength");
-    packetsSentOverTheNet++; packetsSentByMe++; send(request, "gate$o", 0);
+/* recomputes the segment length of current node from the position of its previous
+ * neighbour, as cached in the neighbour table. Called whenever the previous neighbour
+ * or one of the two positions change, so that managership checks are local
+ */
+void DHTMember::updateSegmentLength() {
+    if (neighbours.empty() || neighbours[0].member == NULL || neighbours[0].x == POSITION_UNKNOWN)
+        return;
+
+    updateSegmentLength(neighbours[0].x);
+}
+
+/* recomputes the segment length of current node from the position of its previous
+ * node taken in input, for joins and leaves that know it before any packet is sent
+ */
+void DHTMember::updateSegmentLength(double previousX) {
+    segmentLength = getSegmentLengthByPreviousNodesIntervalPosition(previousX);
 }
 
 void DHTMember::calculateNEstimate() {
@@ -810,12 +1829,9 @@ void DHTMember::calculateNEstimate() {
      * for their segment lengths
      */
     for (i=0; i<2; i++) {
-        request = new Packet("needYourSegmentLength");
-        packetsSentOverTheNet++; packetsSentByMe++; send(request, "gate$o", i);
+        request = createPacket(SEGMENT_LENGTH_REQUEST);
+        sendPacket(request, i);
     }
-
-    /* In the meantime segment length for current node is calculated */
-    calculateSegmentLength();
 }
 
 /* current node execute routing protocol to locate the manager of the
@@ -824,127 +1840,631 @@ void DHTMember::calculateNEstimate() {
 void DHTMember::routingProtocol(double randx, int protocol) {
     Enter_Method("routingProtocol()");
 
-    Packet* response;
-
     /* current node is executing routing protocol
      * to complete another protocol
      */
     runningProtocol = protocol;
 
-    /* current node asks itself if it is the manager for that point */
-    response = new Packet("amITheManagerOfThisPoint?");
-    response->setX(randx);
+    /* current node asks itself if it is the manager for that point,
+     * its segment length is always up to date, so the check is
+     * handled as soon as current event is over
+     */
+    startLookup(createLookup(randx, protocol));
+}
+
+/* current node looks up the manager of the point taken in input on behalf of the member
+ * which index is taken in input, that joins the network next to that manager. The index
+ * goes along with the lookup, so that the joining member is known when the answer comes
+ */
+void DHTMember::joinLookup(double randx, int joiningMember) {
+    Enter_Method("joinLookup()");
+
+    Packet* request;
 
-    /* to do so it calculates its segment length, it will take 0.3
-     * simulated time steps
+    runningProtocol = JOIN;
+    request = createLookup(randx, JOIN);
+    request->setJoiningMember(joiningMember);
+    startLookup(request);
+}
+
+/* returns the packet that starts a lookup for the manager of the point taken in input
+ * on behalf of the protocol taken in input. The lookup is pending until its answer
+ * comes back to current node
+ */
+Packet* DHTMember::createLookup(double randx, int protocol) {
+    Packet* request;
+    LookupState* lookup;
+
+    request = createPacket(MANAGER_CHECK);
+    request->setX(randx);
+    request->setProtocol(protocol);
+    request->setLookupId(DHTMetrics::newLookupId());
+    request->setLookupStart(simTime());
+    lookup = pendingLookups.insert(request->getLookupId());
+    lookup->protocol = protocol;
+    /* greedy hops with every position known take a walk along the links of the
+     * network, only sampled lookups pay for it
      */
-    calculateSegmentLength();
-    scheduleAt(simTime() + 0.3, response);
+    lookup->optimalHops = -1;
+    if (oracle.isEnabled() && pathStretchSampling > 0 && uniform(0, 1) < pathStretchSampling)
+        lookup->optimalHops = getOptimalGreedyHops(randx);
+    lookup->session = session;
+
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " starts " << DHTMetrics::getLookupProtocolName(protocol) << " lookup #" << request->getLookupId() << " for point " << randx << "." << endl;
+
+    return request;
 }
 
-/* current nodes starts procedure to refresh
- * its long links
+/* starts the lookup which packet is taken in input. Under a lookup timeout the lookup
+ * fails if its answer is not back in time, see handleLookupTimeout()
  */
-void DHTMember::relink() {
+void DHTMember::startLookup(Packet* request) {
+    Packet* timeout;
+
+    scheduleAt(simTime(), request);
+
+    if (lookupTimeout > 0) {
+        timeout = createReply(request, LOOKUP_TIMEOUT);
+        scheduleAt(simTime() + lookupTimeout, timeout);
+    }
+}
+
+/* the answer to a lookup started by current node came back, its latency and hop
+ * count are accounted to the protocol that started it, which is returned
+ */
+int DHTMember::lookupCompleted(Packet* reply) {
+    LookupState* lookup;
+    int protocol;
+    int optimalHops;
+    bool abandoned;
+    double stretch;
+
+    /* under a lookup timeout answers may come back after their lookup gave up, or reach
+     * a member that took over a gate of a departed one
+     */
+    lookup = pendingLookups.find(reply->getLookupId());
+    if (lookup == NULL) {
+        if (lookupTimeout == 0)
+            throw cRuntimeError("DHTMember: %s got the answer of lookup #%ld it never started", getFullName(), reply->getLookupId());
+        DHT_INFO << "DHTMember: node " << this->getFullName() << " drops the answer of lookup #" << reply->getLookupId() << ", it is not waiting for it." << endl;
+        return NONE;
+    }
+    protocol = lookup->protocol;
+    optimalHops = lookup->optimalHops;
+    abandoned = lookup->session != session && (protocol == RELINK || protocol == REPAIR);
+    pendingLookups.remove(reply->getLookupId());
+
+    /* current node left the network after it started this relink lookup */
+    if (abandoned)
+        return NONE;
+
+    if (reply->getManager() == NO_MANAGER) {
+        DHT_INFO << "DHTMember: node " << this->getFullName() << " got " << DHTMetrics::getLookupProtocolName(protocol) << " lookup #" << reply->getLookupId() << " rejected after " << reply->getLookupHops() << " hops." << endl;
+        metrics.lookupRejected(protocol);
+        return protocol;
+    }
+
+    DHT_INFO << "DHTMember: node " << this->getFullName() << " completed " << DHTMetrics::getLookupProtocolName(protocol) << " lookup #" << reply->getLookupId() << " in " << simTime() - reply->getLookupStart() << "s and " << reply->getLookupHops() << " hops." << endl;
+    metrics.lookupCompleted(protocol, reply);
+
+    stretch = oracle.lookupCompleted(reply->getX(), reply->getManager(), reply->getLookupHops(), optimalHops);
+    if (stretch > 0)
+        metrics.pathStretchMeasured(stretch);
+
+    return protocol;
+}
+
+/* returns the hops greedy routing takes from current node to the manager of the point
+ * taken in input, through the links of the network as they are now and knowing the
+ * position of every node. Returns -1 if the manager cannot be reached
+ */
+int DHTMember::getOptimalGreedyHops(double point) {
+    int i;
+    int hops = 0;
+    int manager = oracle.getManager(point);
+    double distanceDeltaToPoint;
+    double bestDistance;
+    DHTMember* member = this;
+    DHTMember* next;
+
+    while (member->getIndex() != manager) {
+        next = NULL;
+        bestDistance = 42; /* note: every number >= than 1 could be considered +infinity */
+        for (i=0; i<(int)member->neighbours.size(); i++) {
+            if (member->neighbours[i].member == NULL)
+                continue;
+
+            distanceDeltaToPoint = getDistanceToPoint(member->neighbours[i].member->x, point);
+            if (distanceDeltaToPoint < bestDistance) {
+                bestDistance = distanceDeltaToPoint;
+                next = member->neighbours[i].member;
+            }
+        }
+
+        if (next != NULL && SymphonyRouting::successorIsManager(bestDistance, member->x, point, routingDirection == DIRECTION_BIDIRECTIONAL))
+            next = member->neighbours[1].member;
+
+        /* greedy routing gets closer to the point at every hop, more hops than
+         * members mean the ring is broken
+         */
+        if (next == NULL || hops >= (int)oracle.size())
+            return -1;
+
+        member = next;
+        hops++;
+    }
+
+    return hops;
+}
+
+/* one of the lookups of the running relink got its answer,
+ * relink is complete when all of them did
+ */
+void DHTMember::relinkLookupCompleted() {
+    int K = (int)par("K");
+
+    longLinksCreated++;
+    relinkLookupsPending--;
+    DHT_INFO << "DHTMember: node " << this->getFullName() << " created " << longLinksCreated << "/" << K << " long links." << endl;
+    if (relinkLookupsPending == 0)
+        relinkCompleted();
+}
+
+/* the running relink got the answers of all its lookups, or needed none */
+void DHTMember::relinkCompleted() {
+    longLinksCreated = 0;
+    if (relinkProtocol == REPAIR)
+        metrics.repairCompleted(simTime() - relinkStart);
+
+    /* links lost to departures during the relink are replaced now */
+    if (repairPending) {
+        repairPending = false;
+        relink(REPAIR, repairDeparture);
+    }
+}
+
+/* current node is the manager of the point of the lookup taken in input, it executes
+ * the storage operation the lookup carries. A get carries its result back
+ */
+void DHTMember::executeStorageOperation(Packet* request) {
+    long value;
+
+    if (request->getProtocol() == PUT || request->getProtocol() == GET)
+        metrics.storageRequestManaged();
+
+    if (request->getProtocol() == PUT) {
+        keys.put(request->getKey(), request->getValue());
+    } else if (request->getProtocol() == GET) {
+        request->setFound(keys.get(request->getKey(), value));
+        if (request->getFound())
+            request->setValue(value);
+    }
+}
+
+/* the answer to a put or a get started by current node came back */
+void DHTMember::storageOperationCompleted(Packet* reply, int protocol) {
+    if (protocol == GET) {
+        if (reply->getFound())
+            DHT_TRACE << "DHTMember: node " << this->getFullName() << " read value " << reply->getValue() << " of key " << reply->getKey() << " from node " << reply->getManager() << "." << endl;
+        else
+            DHT_TRACE << "DHTMember: node " << this->getFullName() << " did not find key " << reply->getKey() << " on node " << reply->getManager() << "." << endl;
+        metrics.getCompleted(reply->getFound());
+    } else {
+        DHT_TRACE << "DHTMember: node " << this->getFullName() << " stored key " << reply->getKey() << " on node " << reply->getManager() << "." << endl;
+    }
+}
+
+/* returns true if current node is linked to the ring by both its short links */
+bool DHTMember::isInNetwork() {
+    return neighbours[0].member != NULL && neighbours[1].member != NULL;
+}
+
+/* returns a key of the storage workload, drawn from its key distribution */
+long DHTMember::chooseKey() {
+    if (keyDistribution == KEYS_ZIPF)
+        return std::upper_bound(zipfCdf.begin(), zipfCdf.end() - 1, uniform(0, 1)) - zipfCdf.begin();
+
+    /* KEYS_UNIFORM */
+    return intuniform(0, keySpace - 1);
+}
+
+/* computes the cumulative zipf distribution over the key space, so that chooseKey()
+ * draws a key with a binary search. Key k is the (k + 1)-th most popular one
+ */
+void DHTMember::computeZipfCdf() {
+    long k;
+    double total = 0;
+
+    zipfCdf.resize(keySpace);
+    for (k=0; k<keySpace; k++) {
+        total += 1 / pow((double)(k + 1), zipfSkew);
+        zipfCdf[k] = total;
+    }
+    for (k=0; k<keySpace; k++)
+        zipfCdf[k] /= total;
+    zipfCdfSkew = zipfSkew;
+}
+
+/* forwards the lookup taken in input straight to the cached manager of its point,
+ * linked or not, and returns true. The manager checks its own segment as any hop
+ * does, then a stale entry costs a few greedy hops more and never a wrong answer.
+ * A lookup takes one shortcut at most, so that stale entries of different nodes
+ * cannot send it round in circles. Returns false if the lookup has to be routed
+ */
+bool DHTMember::routeByManagerCache(Packet* request) {
+    unsigned int i;
+    int manager;
+    DHTMember* managerMember;
+    Packet* response;
+
+    if (!managerCache.isEnabled())
+        return false;
+
+    for (i=0; i<request->getRoutingListArraySize(); i++) {
+        if (request->getRoutingList(i) < 0)
+            return false;
+    }
+
+    manager = managerCache.lookup(request->getX());
+    metrics.managerCacheLookup(manager >= 0);
+    if (manager < 0)
+        return false;
+
+    /* current node is not the manager of the point, or a member that left cannot be
+     * contacted: the entry is out of date
+     */
+    managerMember = getMember(manager);
+    if (managerMember == this || !managerMember->isInNetwork()) {
+        managerCache.invalidate(request->getX());
+        return false;
+    }
+
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " forwards lookup #" << request->getLookupId() << " to cached manager " << manager << "." << endl;
+
+    /* the answer will come back through current node */
+    metrics.lookupForwarded();
+    response = reuseRequest(request, MANAGER_QUERY);
+    response->pushRoutingList(DIRECT_HOP(getIndex()));
+    sendPacketDirect(response, managerMember);
+    return true;
+}
+
+/* drops the cached segments containing the point taken in input from the caches of
+ * current node and of its neighbours, after a join or a leave changed that segment.
+ * Nodes further away find out when their entries expire
+ */
+void DHTMember::invalidateManagerCaches(double point) {
+    int i;
+
+    managerCache.invalidate(point);
+    for (i=0; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL)
+            neighbours[i].member->managerCache.invalidate(point);
+    }
+}
+
+/* queues for service a packet received from another member. A full queue takes no
+ * packet: under the reject policy new lookups go back to their origin as rejected,
+ * every other packet is dropped. Origins give up on lookups whose answers were
+ * dropped after lookupTimeout, dropped estimation packets are not sent again
+ */
+void DHTMember::enqueuePacket(Packet* request) {
+    if ((int)serviceQueue.size() >= queueCapacity) {
+        if (queueOverflow == OVERFLOW_REJECT && request->getKind() == MANAGER_QUERY) {
+            rejectLookup(request);
+        } else {
+            DHT_TRACE << "DHTMember: node " << this->getFullName() << " has got a full queue and drops packet " << request->getName() << "." << endl;
+            metrics.packetDropped();
+            releasePacket(request);
+        }
+        return;
+    }
+
+    serviceQueue.push_back(request);
+    metrics.queueLengthChanged(serviceQueue.size());
+    if (!serviceTimer->isScheduled())
+        startService();
+}
+
+/* starts serving the packet at the head of the queue */
+void DHTMember::startService() {
+    Packet* request = serviceQueue.front();
+
+    metrics.serviceStarted(simTime() - request->getArrivalTime());
+    scheduleAt(simTime() + serviceTimes[request->getKind()], serviceTimer);
+}
+
+/* the packet at the head of the queue has been served, it is handled
+ * and the next one starts its service
+ */
+void DHTMember::finishService() {
+    Packet* request = serviceQueue.front();
+
+    serviceQueue.pop_front();
+    metrics.queueLengthChanged(serviceQueue.size());
+    processPacket(request);
+
+    if (!serviceQueue.empty())
+        startService();
+}
+
+/* current node has no room for the lookup taken in input. It is sent back along its
+ * routing list as the answer of an unknown manager, so that the node who made the
+ * request knows it was dropped
+ */
+void DHTMember::rejectLookup(Packet* request) {
+    DHT_TRACE << "DHTMember: node " << this->getFullName() << " has got a full queue and rejects lookup #" << request->getLookupId() << "." << endl;
+
+    request->setLookupHops(request->getRoutingListArraySize());
+    request->setManager(NO_MANAGER);
+    request->setManagerSegmentLength(0);
+    request->setKind(MANAGER_INDEX);
+    request->setName(getOpcodeLabel(MANAGER_INDEX));
+    sendBackAlongRoutingList(request);
+}
+
+/* a lookup started by current node was rejected by a saturated node on the way or
+ * timed out, the protocol that started it goes on without the answer
+ */
+void DHTMember::lookupRejected(Packet* reply, int protocol) {
+    if (protocol == RELINK || protocol == REPAIR) {
+        relinkLookupCompleted();
+    } else if (protocol == JOIN) {
+        /* the joining node tries again later, from another position */
+        getMember(reply->getJoiningMember())->join(exponential(10));
+    }
+}
+
+/* records how storage requests spread over the members in the network at the end of
+ * the run. The histogram of requests managed by each member shows hot spot managers,
+ * the imbalance is the ratio between the busiest member load and the mean load
+ */
+void DHTMember::recordStorageLoad() {
+    int i;
+    int DHTSize;
+    int members = 0;
+    long load;
+    long maxLoad = 0;
+    long totalLoad = 0;
+    DHTMember* member;
+    cLongHistogram loadHistogram;
+
+    DHTSize = (int)getAncestorPar("DHTSize");
+    for (i=0; i<DHTSize; i++) {
+        member = (DHTMember*)getParentModule()->getSubmodule("members", i);
+        if (!member->isInNetwork())
+            continue;
+
+        load = member->metrics.getStorageRequestsManaged();
+        loadHistogram.collect(load);
+        members++;
+        totalLoad += load;
+        if (load > maxLoad)
+            maxLoad = load;
+    }
+
+    if (totalLoad == 0)
+        return;
+
+    loadHistogram.recordAs("storage requests managed per node");
+    recordScalar("#storageLoadImbalance", maxLoad / ((double)totalLoad / members));
+}
+
+/* current nodes starts procedure to refresh its long links on behalf of
+ * the protocol taken in input, RELINK or REPAIR after a departure. The relink
+ * counts from the start time taken in input, the departure it repairs for REPAIR
+ */
+void DHTMember::relink(int protocol, simtime_t start) {
+    int i;
+    int K;
+    int lookups;
+    int linksKept = 0;
+    int grownLookups = 0;
+    bool drawnLinks = false;
     double randx;
+    double previousEstimate;
+
+    /* links of a relink still running are already being replaced */
+    if (relinkLookupsPending > 0)
+        return;
+
+    relinkProtocol = protocol;
+    relinkStart = start;
 
     /* estimate at relinking time for current node
      * is a copy of the old estimate
      */
+    previousEstimate = nEstimateAtLinking;
     nEstimateAtLinking = nEstimate;
 
-    /* if current node is going to relink its first connection
-     * then drop all long links
-     */
-    if (longLinksCreated == 0)
+    K = (int)par("K");
+    for (i=2; i<(int)neighbours.size(); i++) {
+        if (neighbours[i].member != NULL && neighbours[i].linkLength != LENGTH_UNKNOWN)
+            drawnLinks = true;
+    }
+
+    if (relinkMode == RELINK_INCREMENTAL && drawnLinks) {
+        /* long links current node drew that are still harmonic samples for the new
+         * estimate are kept, the others keep routing until their replacements are
+         * linked. Links drawn by the other end are left to it
+         */
+        for (i=2; i<(int)neighbours.size(); i++) {
+            neighbours[i].retiring = false;
+            if (neighbours[i].member == NULL || neighbours[i].linkLength == LENGTH_UNKNOWN)
+                continue;
+
+            if (SymphonyRouting::isHarmonicSample(neighbours[i].linkLength, nEstimate, previousEstimate, drand48())) {
+                linksKept++;
+            } else {
+                neighbours[i].retiring = true;
+                /* links of a grown estimate are replaced by lengths it alone draws */
+                if (nEstimate > previousEstimate)
+                    grownLookups++;
+            }
+        }
+        lookups = K - linksKept;
+    } else {
+        /* all long links are dropped and their replacements looked up at once,
+         * relink takes as long as the slowest of the K lookups
+         */
         dropAllLongLinks();
+        lookups = K;
+    }
 
-    /* generate a random position over the unit interval
-     * using armonic probability density function
-     */
-    randx = exp(log(nEstimate)*(drand48() - 1.0));
+    metrics.relinkStarted(linksKept);
+    relinkLookupsPending = lookups;
 
-    /* use routing protocol to locate that position manager
-     * completing relink when it will be found
-     */
-    routingProtocol(randx, RELINK);
+    /* every drawn link was kept, the relink is complete at once */
+    if (lookups == 0) {
+        relinkCompleted();
+        return;
+    }
+
+    for (i=0; i<lookups; i++) {
+        /* generate a random position over the unit interval
+         * using armonic probability density function
+         */
+        if (i < grownLookups)
+            randx = SymphonyRouting::getGrownHarmonicDistance(nEstimate, previousEstimate, drand48());
+        else
+            randx = SymphonyRouting::getHarmonicDistance(nEstimate, drand48());
+
+        /* use routing protocol to locate that position manager,
+         * a long link to it is created when it will be found
+         */
+        routingProtocol(randx, protocol);
+    }
 }
 
 /* current nodes starts procedure to enter the network */
 void DHTMember::join(simtime_t delay) {
-    Packet* joinPacket = new Packet("joinNetwork");
+    Enter_Method_Silent();
+
+    Packet* joinPacket = createPacket(JOIN_NETWORK);
     scheduleAt(simTime() + delay, joinPacket);
 }
 
 /* current nodes starts procedure to exit the network */
 void DHTMember::leave(simtime_t delay) {
-    Packet* leavePacket = new Packet("leaveNetwork");
+    Enter_Method_Silent();
+
+    Packet* leavePacket = createPacket(LEAVE_NETWORK);
     scheduleAt(simTime() + delay, leavePacket);
 }
 
-/* returns the first member of the network that was not connected to the DHT when
- * the simulation started and that has got an interval position that is the
- * same of the one taken in input
- */
-DHTMember* DHTMember::getMemberWithSpecificIntervalPosition(double randx) {
-    int i;
-    int connected;
-    int DHTSize;
-    DHTMember* member;
+/* current node entered the network, under churn it will leave it after a session */
+void DHTMember::startSession() {
+    Enter_Method_Silent();
 
-    connected = (int)getAncestorPar("connected");
-    DHTSize = (int)getAncestorPar("DHTSize");
-    for (i=connected; i<DHTSize; i++) {
-        member = (DHTMember*)getParentModule()->getSubmodule("members", i);
-        if (member->x == randx)
-            return member;
-    }
+    networkMembersSlot = networkMembers.size();
+    networkMembers.push_back(getIndex());
 
-    return NULL;
+    if (churnModel != CHURN_NONE)
+        leave(getSessionLength());
 }
 
-/* puts (using short links) the node which interval position is taken in input between
- * the node which id is taken in input and its predecessor.
+/* returns the length of a session of current node, drawn from its churn model */
+simtime_t DHTMember::getSessionLength() {
+    /* a pareto distribution of shape a > 1 and scale b has mean a * b / (a - 1) */
+    if (churnModel == CHURN_PARETO)
+        return pareto_shifted(paretoShape, SIMTIME_DBL(sessionLength) * (paretoShape - 1) / paretoShape, 0);
+
+    /* CHURN_EXPONENTIAL */
+    return exponential(SIMTIME_DBL(sessionLength));
+}
+
+/* returns the member which index is taken in input */
+DHTMember* DHTMember::getMember(int index) {
+    return (DHTMember*)getParentModule()->getSubmodule("members", index);
+}
+
+/* puts (using short links) the joining node which id is taken in input between
+ * the manager which id is taken in input and its predecessor.
  * This procedure returns the joining member
  */
-DHTMember* DHTMember::addNodeWithSpecificIntervalPosition(double randx, int manager) {
+DHTMember* DHTMember::addJoiningMember(int joiningMemberIndex, int manager) {
     DHTMember* joiningMember;
     DHTMember* managerMember;
     DHTMember* managerPredecessorMember;
-    cGate* joiningInLeft;
-    cGate* joiningOutLeft;
-    cGate* joiningInRight;
-    cGate* joiningOutRight;
-    cGate* managerIn;
-    cGate* managerOut;
-    cGate* managerPredIn;
-    cGate* managerPredOut;
 
     /* get joining member, the node to connect it to and its predecessor */
-    joiningMember = (DHTMember*)getMemberWithSpecificIntervalPosition(randx);
-    managerMember = (DHTMember*)(getParentModule()->getSubmodule("members", manager));
-    managerPredecessorMember = (DHTMember*)(managerMember->gate("gate$o", 0)->getNextGate()->getOwnerModule());
+    joiningMember = getMember(joiningMemberIndex);
+    managerMember = getMember(manager);
+    managerPredecessorMember = managerMember->neighbours[0].member;
 
     /* disconnect that node and its predecessor */
-    disconnectGate(managerMember->gate("gate$o", 0));
+    managerMember->disconnectGate(0);
 
-    joiningInLeft   = joiningMember->gate("gate$i", 0);
-    joiningOutLeft  = joiningMember->gate("gate$o", 0);
-    joiningInRight  = joiningMember->gate("gate$i", 1);
-    joiningOutRight = joiningMember->gate("gate$o", 1);
+    /* connect joining node between other two nodes */
+    joiningMember->connectGate(0, managerPredecessorMember, 1);
+    managerMember->connectGate(0, joiningMember, 1);
 
-    managerIn  = managerMember->gate("gate$i", 0);
-    managerOut = managerMember->gate("gate$o", 0);
+    /* both segments change within the join, so that managership checks never
+     * answer from the overlapping segments of the joining node and of the manager
+     */
+    joiningMember->updateSegmentLength(managerPredecessorMember->x);
+    managerMember->updateSegmentLength(joiningMember->x);
 
-    managerPredIn  = managerPredecessorMember->gate("gate$i", 1);
-    managerPredOut = managerPredecessorMember->gate("gate$o", 1);
+    /* the joining node becomes the manager of the keys of its segment,
+     * the manager hands them over
+     */
+    managerMember->metrics.keysMoved(managerMember->keys.moveKeysTo(joiningMember->keys, managerPredecessorMember->x, joiningMember->x));
 
-    /* connect joining node between other two nodes */
-    joiningOutLeft->connectTo(managerPredIn);
-    managerPredOut->connectTo(joiningInLeft);
+    /* the segment of the manager was split, caches around it are out of date */
+    managerMember->invalidateManagerCaches(joiningMember->x);
 
-    managerOut->connectTo(joiningInRight);
-    joiningOutRight->connectTo(managerIn);
+    oracle.memberJoined(joiningMember->x, joiningMemberIndex);
+    joiningMember->startSession();
 
     return joiningMember;
 }
+
+/* ===========================================
+ * |          storage layer methods          |
+ * ===========================================
+ */
+
+/* stores the value taken in input under the key taken in input on the manager of the
+ * key position. Storage lookups leave the running protocol of current node untouched
+ */
+void DHTMember::put(long key, long value) {
+    Enter_Method("put()");
+
+    Packet* request;
+
+    request = createLookup(KeyStore::getKeyPosition(key), PUT);
+    request->setKey(key);
+    request->setValue(value);
+    startLookup(request);
+}
+
+/* reads the value stored under the key taken in input from the manager of the key position */
+void DHTMember::get(long key) {
+    Enter_Method("get()");
+
+    Packet* request;
+
+    request = createLookup(KeyStore::getKeyPosition(key), GET);
+    request->setKey(key);
+    startLookup(request);
+}
+
+/* starts the next operation of the storage workload, readRatio of them are gets.
+ * Nodes out of the network skip it
+ */
+void DHTMember::startStorageOperation() {
+    if (!isInNetwork())
+        return;
+
+    /* a saturated node may stop starting operations of its own */
+    if (throttleStorage && (int)serviceQueue.size() >= queueCapacity) {
+        metrics.storageOperationThrottled();
+        return;
+    }
+
+    storageOperationsStarted++;
+    if (uniform(0, 1) < readRatio)
+        get(chooseKey());
+    else
+        put(chooseKey(), storageOperationsStarted);
+}
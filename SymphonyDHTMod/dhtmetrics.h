@@ -0,0 +1,148 @@
+#ifndef _DHTMETRICS_H_
+#define _DHTMETRICS_H_
+
+#include <omnetpp.h>
+#include "packet.h"
+
+/* protocol phases packets are accounted to */
+#define PHASE_ESTIMATION 0
+#define PHASE_LOOKUP     1
+#define PHASE_MEMBERSHIP 2
+#define PHASES_NUMBER    3
+
+/* lookups are accounted to the protocol that started them, indexed as the
+ * RELINK (0), JOIN (1), PUT (2), GET (3) and REPAIR (4) protocols of DHTMember.
+ * Packets of REPAIR lookups are the maintenance traffic caused by departures
+ */
+#define LOOKUP_PROTOCOL_REPAIR  4
+#define LOOKUP_PROTOCOLS_NUMBER 5
+
+/* traffic and lookup metrics of one DHT member. Every packet sent goes through
+ * packetSent(), which updates per-opcode counters of the member and of the whole
+ * network and emits the signals declared with @signal / @statistic in package.ned.
+ * Network-wide counters live for one run: they are reset by resetNetwork() when
+ * the first member is initialized and recorded by the same member at the end
+ */
+class DHTMetrics
+{
+  private:
+    cModule* owner;
+    long packetsSent[OPCODES_NUMBER];
+    long bytesSent;
+    long keysHandedOff;
+    long storageRequestsManaged;
+    long lookupsInTransit;
+
+    static long networkPacketsSent[OPCODES_NUMBER];
+    static long networkPacketsSentTotal;
+    static long networkBytesSent;
+    static long networkLookups[LOOKUP_PROTOCOLS_NUMBER];
+    static long networkKeysHandedOff;
+    static long networkManagerCacheHits;
+    static long networkLookupsRejected[LOOKUP_PROTOCOLS_NUMBER];
+    static long networkStorageOperationsThrottled;
+    static long networkLookupsFailed[LOOKUP_PROTOCOLS_NUMBER];
+    static long networkPacketsLost;
+    static long networkPacketsDropped;
+    static long networkDepartures;
+    static long networkRepairPacketsSent;
+    static long networkRepairs;
+    static long networkRelinks;
+    static long networkRelinkLinksKept;
+    static double networkRepairTimeSum;
+    static double networkRepairTimeMax;
+    static long nextLookupId;
+
+    static const int phaseOfOpcode[OPCODES_NUMBER];
+    static const char* phaseNames[PHASES_NUMBER];
+    static const char* lookupProtocolNames[LOOKUP_PROTOCOLS_NUMBER];
+
+    static simsignal_t packetSentSignal;
+    static simsignal_t packetBytesSignal;
+    static simsignal_t phasePacketSentSignals[PHASES_NUMBER];
+    static simsignal_t lookupHopsSignal;
+    static simsignal_t lookupLatencySignal;
+    static simsignal_t protocolLookupHopsSignals[LOOKUP_PROTOCOLS_NUMBER];
+    static simsignal_t protocolLookupLatencySignals[LOOKUP_PROTOCOLS_NUMBER];
+    static simsignal_t getHitSignal;
+    static simsignal_t storageRequestManagedSignal;
+    static simsignal_t lookupsInTransitSignal;
+    static simsignal_t managerCacheHitSignal;
+    static simsignal_t queueLengthSignal;
+    static simsignal_t queueingTimeSignal;
+    static simsignal_t lookupRejectedSignal;
+    static simsignal_t pathStretchSignal;
+    static simsignal_t lookupFailedSignal;
+    static simsignal_t repairTimeSignal;
+    static simsignal_t longLinksSignal;
+    static simsignal_t relinkLinksKeptSignal;
+
+    static const char* getOpcodeName(int opcode);
+
+  public:
+    DHTMetrics();
+
+    void initialize(cModule* owner);
+    static void resetNetwork();
+
+    /* accounts a packet that is being sent by the owner */
+    void packetSent(Packet* packet);
+    /* returns the identifier of a new lookup, unique within current run */
+    static long newLookupId();
+    /* the answer to a lookup started by the owner for the given protocol came back,
+     * reply carries its start time and the hops it took to reach the manager
+     */
+    void lookupCompleted(int protocol, Packet* reply);
+    static const char* getLookupProtocolName(int protocol);
+    /* a get started by the owner completed, found tells whether the key was stored */
+    void getCompleted(bool found);
+    /* the owner moved keys it was storing to another member, on join or leave */
+    void keysMoved(long keys);
+    /* the owner executed a put or a get as the manager of its key */
+    void storageRequestManaged();
+    /* the owner forwarded a lookup towards its manager, lookups forwarded by the
+     * owner stay in transit until their answer comes back through it
+     */
+    void lookupForwarded();
+    void lookupReturned();
+    /* the owner looked up the manager of a point in its manager cache */
+    void managerCacheLookup(bool hit);
+    /* the queue of packets waiting for service at the owner changed its length */
+    void queueLengthChanged(long length);
+    /* the owner started serving a packet that waited in its queue for the time taken in input */
+    void serviceStarted(simtime_t queueingTime);
+    /* the owner had no room for a lookup of the given protocol and rejected it */
+    void lookupRejected(int protocol);
+    /* the owner skipped an operation of its storage workload because it is saturated */
+    void storageOperationThrottled();
+    /* the answer to a lookup started by the owner took stretch times the hops of greedy
+     * routing with every position known, see RoutingOracle
+     */
+    void pathStretchMeasured(double stretch);
+    /* a lookup started by the owner for the given protocol got no answer in time */
+    void lookupFailed(int protocol);
+    /* the owner dropped a packet, it was out of the network or the link was gone */
+    void packetLost();
+    /* the owner dropped a packet that found its service queue full */
+    void packetDropped();
+    /* the owner left the network */
+    void memberLeft();
+    /* the owner looked up again the long links it lost to a departure, in the time
+     * taken in input since that departure
+     */
+    void repairCompleted(simtime_t time);
+    /* the owner has the number of long links taken in input since a link was created or dropped */
+    void longLinksChanged(long longLinks);
+    /* the owner started a relink keeping the number of its long links taken in input */
+    void relinkStarted(long linksKept);
+    long getStorageRequestsManaged() const {return storageRequestsManaged;}
+
+    long getPacketsSent() const;
+    /* total number of packets sent over the network during current run */
+    static long getNetworkPacketsSent() {return networkPacketsSentTotal;}
+
+    void record();
+    static void recordNetwork(cModule* recorder);
+};
+
+#endif // _DHTMETRICS_H_
@@ -0,0 +1,60 @@
+#include <math.h>
+#include "keystore.h"
+
+/* fibonacci hashing: consecutive keys are spread evenly over the unit interval */
+double KeyStore::getKeyPosition(long key) {
+    double position = fmod((double)key * 0.6180339887498949, 1.0);
+    return position < 0 ? position + 1 : position;
+}
+
+/* returns true if p lies in (from, to] going clockwise, the interval
+ * wraps around 0 when from is not lower than to
+ */
+bool KeyStore::isInInterval(double p, double from, double to) {
+    if (from < to)
+        return p > from && p <= to;
+    return p > from || p <= to;
+}
+
+void KeyStore::put(long key, long value) {
+    entries[key] = value;
+}
+
+bool KeyStore::get(long key, long& value) const {
+    std::map<long, long>::const_iterator entry = entries.find(key);
+
+    if (entry == entries.end())
+        return false;
+
+    value = entry->second;
+    return true;
+}
+
+long KeyStore::moveKeysTo(KeyStore& other, double from, double to) {
+    std::map<long, long>::iterator entry;
+    long moved = 0;
+
+    entry = entries.begin();
+    while (entry != entries.end()) {
+        if (isInInterval(getKeyPosition(entry->first), from, to)) {
+            other.entries[entry->first] = entry->second;
+            entries.erase(entry++);
+            moved++;
+        } else {
+            ++entry;
+        }
+    }
+
+    return moved;
+}
+
+long KeyStore::moveAllKeysTo(KeyStore& other) {
+    std::map<long, long>::iterator entry;
+    long moved = (long)entries.size();
+
+    for (entry=entries.begin(); entry!=entries.end(); ++entry)
+        other.entries[entry->first] = entry->second;
+    entries.clear();
+
+    return moved;
+}
@@ -0,0 +1,35 @@
+#ifndef _KEYSTORE_H_
+#define _KEYSTORE_H_
+
+#include <map>
+
+/* key/value pairs stored by one DHT member. Every key is hashed to a position on the
+ * unit interval and is stored by the manager of that position, that is the first
+ * member at or after it going clockwise
+ */
+class KeyStore
+{
+  private:
+    std::map<long, long> entries;
+
+    static bool isInInterval(double p, double from, double to);
+
+  public:
+    /* returns the position on the unit interval the key taken in input is hashed to */
+    static double getKeyPosition(long key);
+
+    void put(long key, long value);
+    /* returns true and copies the value of the key taken in input if it is stored */
+    bool get(long key, long& value) const;
+
+    /* moves into other the keys which position lies in (from, to] going clockwise,
+     * returns how many keys were moved
+     */
+    long moveKeysTo(KeyStore& other, double from, double to);
+    /* moves every key into other, returns how many keys were moved */
+    long moveAllKeysTo(KeyStore& other);
+
+    long size() const {return (long)entries.size();}
+};
+
+#endif // _KEYSTORE_H_
@@ -0,0 +1,58 @@
+#ifndef _LOOKUPTABLE_H_
+#define _LOOKUPTABLE_H_
+
+/* state a node keeps about one lookup in flight, identified by the lookup ID
+ * carried in every Packet of that lookup
+ *
+ * protocol: protocol that started the lookup, for lookups started by current node
+ * optimalHops: hops of greedy routing with every position known when the lookup
+ *              started, -1 if unknown, for lookups started by current node
+ * session: session of current node the lookup was started in, for lookups started
+ *          by current node
+ */
+struct LookupState {
+    long lookupId;
+    int protocol;
+    int optimalHops;
+    int session;
+};
+
+/* open addressing hash table of lookups in flight, keyed by lookup ID. Collisions are
+ * resolved by linear probing and removals shift following entries back, so that no
+ * tombstone is left behind. The table doubles when it gets half full and never shrinks.
+ * Pointers returned by find() and insert() are valid until the next insert() or remove()
+ */
+class LookupTable
+{
+  private:
+    struct Slot {
+        bool used;
+        LookupState state;
+    };
+
+    Slot* slots;
+    unsigned int capacity;
+    unsigned int count;
+
+    unsigned int getHomeIndex(long lookupId) const;
+    int getSlotIndex(long lookupId) const;
+    void grow();
+
+    /* lookup tables are never copied */
+    LookupTable(const LookupTable& other);
+    LookupTable& operator=(const LookupTable& other);
+
+  public:
+    LookupTable(unsigned int initialCapacity=8);
+    ~LookupTable();
+
+    /* returns the state of the lookup taken in input, NULL if it is not in the table */
+    LookupState* find(long lookupId);
+    /* returns the state of the lookup taken in input, adding a cleared one if missing */
+    LookupState* insert(long lookupId);
+    void remove(long lookupId);
+    void clear();
+    unsigned int size() const {return count;}
+};
+
+#endif // _LOOKUPTABLE_H_
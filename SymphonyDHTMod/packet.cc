@@ -0,0 +1,113 @@
+#include "packet.h"
+
+Register_Class(Packet);
+
+Packet::Packet(const char *name, int kind) : Packet_Base(name, kind) {
+    routingList = routingListInline;
+    routingListSize = 0;
+    routingListCapacity = ROUTING_LIST_INLINE_SIZE;
+}
+
+Packet::Packet(const Packet& other) : Packet_Base(other) {
+    routingList = routingListInline;
+    routingListSize = 0;
+    routingListCapacity = ROUTING_LIST_INLINE_SIZE;
+    copy(other);
+}
+
+Packet::~Packet() {
+    if (routingList != routingListInline)
+        delete [] routingList;
+}
+
+Packet& Packet::operator=(const Packet& other) {
+    if (this == &other)
+        return *this;
+    Packet_Base::operator=(other);
+    copy(other);
+    return *this;
+}
+
+/* copies the routing list of the packet taken in input, memory is
+ * allocated only if it does not fit in the space already owned
+ */
+void Packet::copy(const Packet& other) {
+    unsigned int i;
+    reserveRoutingList(other.routingListSize);
+    for (i=0; i<other.routingListSize; i++)
+        routingList[i] = other.routingList[i];
+    routingListSize = other.routingListSize;
+}
+
+/* makes room for at least capacity gate indices, moving the routing list
+ * to the heap when it outgrows inline storage. Capacity is doubled on every
+ * growth and never released, so a recycled packet does not allocate again
+ */
+void Packet::reserveRoutingList(unsigned int capacity) {
+    unsigned int i;
+    int* grown;
+
+    if (capacity <= routingListCapacity)
+        return;
+
+    while (routingListCapacity < capacity)
+        routingListCapacity *= 2;
+
+    grown = new int[routingListCapacity];
+    for (i=0; i<routingListSize; i++)
+        grown[i] = routingList[i];
+
+    if (routingList != routingListInline)
+        delete [] routingList;
+    routingList = grown;
+}
+
+void Packet::parsimPack(cCommBuffer *b) {
+    Packet_Base::parsimPack(b);
+    b->pack(routingListSize);
+    doPacking(b, routingList, routingListSize);
+}
+
+void Packet::parsimUnpack(cCommBuffer *b) {
+    unsigned int size;
+    Packet_Base::parsimUnpack(b);
+    b->unpack(size);
+    routingListSize = 0;
+    reserveRoutingList(size);
+    doUnpacking(b, routingList, size);
+    routingListSize = size;
+}
+
+/* appends the gate index taken in input on top of the routing list */
+void Packet::pushRoutingList(int gateIndex) {
+    if (routingListSize == routingListCapacity)
+        reserveRoutingList(routingListSize + 1);
+    routingList[routingListSize++] = gateIndex;
+}
+
+/* removes and returns the gate index on top of the routing list */
+int Packet::popRoutingList() {
+    if (routingListSize == 0)
+        throw cRuntimeError("Packet: pop from an empty routing list");
+    return routingList[--routingListSize];
+}
+
+void Packet::setRoutingListArraySize(unsigned int size) {
+    unsigned int i;
+    reserveRoutingList(size);
+    for (i=routingListSize; i<size; i++)
+        routingList[i] = 0;
+    routingListSize = size;
+}
+
+int Packet::getRoutingList(unsigned int k) const {
+    if (k >= routingListSize)
+        throw cRuntimeError("Array of size %d indexed by %d", routingListSize, k);
+    return routingList[k];
+}
+
+void Packet::setRoutingList(unsigned int k, int gateIndex) {
+    if (k >= routingListSize)
+        throw cRuntimeError("Array of size %d indexed by %d", routingListSize, k);
+    routingList[k] = gateIndex;
+}
@@ -15,43 +15,119 @@
 
 
 
+/**
+ * Enum generated from <tt>packet.msg</tt> by opp_msgc.
+ * <pre>
+ * enum Opcode
+ * {
+ *     SEGMENT_LENGTH_REQUEST = 0;
+ *     SEGMENT_LENGTH_REPLY = 1;
+ *     ESTIMATE_UPDATE = 2;
+ *     MANAGER_CHECK = 3;
+ *     MANAGER_QUERY = 4;
+ *     MANAGER_INDEX = 5;
+ *     JOIN_NETWORK = 6;
+ *     LEAVE_NETWORK = 7;
+ *     RELINK_REQUEST = 8;
+ *     LOOKUP_TIMEOUT = 9;
+ *     OPCODES_NUMBER = 10;
+ * };
+ * </pre>
+ */
+enum Opcode {
+    SEGMENT_LENGTH_REQUEST = 0,
+    SEGMENT_LENGTH_REPLY = 1,
+    ESTIMATE_UPDATE = 2,
+    MANAGER_CHECK = 3,
+    MANAGER_QUERY = 4,
+    MANAGER_INDEX = 5,
+    JOIN_NETWORK = 6,
+    LEAVE_NETWORK = 7,
+    RELINK_REQUEST = 8,
+    LOOKUP_TIMEOUT = 9,
+    OPCODES_NUMBER = 10,
+};
+
 /**
  * Class generated from <tt>packet.msg</tt> by opp_msgc.
  * <pre>
  * packet Packet {
+ *     @customize(true);
  * 	double x;
  * 	double segmentLength;
  * 	double nEstimate;
- * 	int toSenderGateIndex;	
- *     int routingList[];
+ *     abstract int routingList[];
  *     int manager;
+ *     long lookupId;
+ *     simtime_t lookupStart;
+ *     int lookupHops;
+ *     int protocol;
+ *     long key;
+ *     long value;
+ *     bool found;
+ *     double managerX;
+ *     double managerSegmentLength;
+ *     int joiningMember;
  * }
  * </pre>
+ *
+ * Packet_Base is only useful if it gets subclassed, and Packet is derived from it.
+ * The minimum code to be written for Packet is the following:
+ *
+ * <pre>
+ * class Packet : public Packet_Base
+ * {
+ *   private:
+ *     void copy(const Packet& other) { ... }
+
+ *   public:
+ *     Packet(const char *name=NULL, int kind=0) : Packet_Base(name,kind) {}
+ *     Packet(const Packet& other) : Packet_Base(other) {copy(other);}
+ *     Packet& operator=(const Packet& other) {if (this==&other) return *this; Packet_Base::operator=(other); copy(other); return *this;}
+ *     virtual Packet *dup() const {return new Packet(*this);}
+ *     // ADD CODE HERE to redefine and implement pure virtual functions from Packet_Base
+ * };
+ * </pre>
+ *
+ * The following should go into a .cc (.cpp) file:
+ *
+ * <pre>
+ * Register_Class(Packet);
+ * </pre>
  */
-class Packet : public ::cPacket
+class Packet_Base : public ::cPacket
 {
   protected:
     double x_var;
     double segmentLength_var;
     double nEstimate_var;
-    int toSenderGateIndex_var;
-    int *routingList_var; // array ptr
-    unsigned int routingList_arraysize;
     int manager_var;
+    long lookupId_var;
+    simtime_t lookupStart_var;
+    int lookupHops_var;
+    int protocol_var;
+    long key_var;
+    long value_var;
+    bool found_var;
+    double managerX_var;
+    double managerSegmentLength_var;
+    int joiningMember_var;
 
   private:
-    void copy(const Packet& other);
+    void copy(const Packet_Base& other);
 
   protected:
     // protected and unimplemented operator==(), to prevent accidental usage
-    bool operator==(const Packet&);
+    bool operator==(const Packet_Base&);
+    // make constructors protected to avoid instantiation
+    Packet_Base(const char *name=NULL, int kind=0);
+    Packet_Base(const Packet_Base& other);
+    // make assignment operator protected to force the user override it
+    Packet_Base& operator=(const Packet_Base& other);
 
   public:
-    Packet(const char *name=NULL, int kind=0);
-    Packet(const Packet& other);
-    virtual ~Packet();
-    Packet& operator=(const Packet& other);
-    virtual Packet *dup() const {return new Packet(*this);}
+    virtual ~Packet_Base();
+    virtual Packet_Base *dup() const {throw cRuntimeError("You forgot to manually add a dup() function to class Packet");}
     virtual void parsimPack(cCommBuffer *b);
     virtual void parsimUnpack(cCommBuffer *b);
 
@@ -62,18 +138,36 @@ class Packet : public ::cPacket
     virtual void setSegmentLength(double segmentLength);
     virtual double getNEstimate() const;
     virtual void setNEstimate(double nEstimate);
-    virtual int getToSenderGateIndex() const;
-    virtual void setToSenderGateIndex(int toSenderGateIndex);
-    virtual void setRoutingListArraySize(unsigned int size);
-    virtual unsigned int getRoutingListArraySize() const;
-    virtual int getRoutingList(unsigned int k) const;
-    virtual void setRoutingList(unsigned int k, int routingList);
+    virtual void setRoutingListArraySize(unsigned int size) = 0;
+    virtual unsigned int getRoutingListArraySize() const = 0;
+    virtual int getRoutingList(unsigned int k) const = 0;
+    virtual void setRoutingList(unsigned int k, int routingList) = 0;
     virtual int getManager() const;
     virtual void setManager(int manager);
+    virtual long getLookupId() const;
+    virtual void setLookupId(long lookupId);
+    virtual simtime_t getLookupStart() const;
+    virtual void setLookupStart(simtime_t lookupStart);
+    virtual int getLookupHops() const;
+    virtual void setLookupHops(int lookupHops);
+    virtual int getProtocol() const;
+    virtual void setProtocol(int protocol);
+    virtual long getKey() const;
+    virtual void setKey(long key);
+    virtual long getValue() const;
+    virtual void setValue(long value);
+    virtual bool getFound() const;
+    virtual void setFound(bool found);
+    virtual double getManagerX() const;
+    virtual void setManagerX(double managerX);
+    virtual double getManagerSegmentLength() const;
+    virtual void setManagerSegmentLength(double managerSegmentLength);
+    virtual int getJoiningMember() const;
+    virtual void setJoiningMember(int joiningMember);
 };
 
-inline void doPacking(cCommBuffer *b, Packet& obj) {obj.parsimPack(b);}
-inline void doUnpacking(cCommBuffer *b, Packet& obj) {obj.parsimUnpack(b);}
+inline void doPacking(cCommBuffer *b, Packet_Base& obj) {obj.parsimPack(b);}
+inline void doUnpacking(cCommBuffer *b, Packet_Base& obj) {obj.parsimUnpack(b);}
 
 
 #endif // _PACKET_M_H_
@@ -0,0 +1,51 @@
+#include "ringindex.h"
+
+unsigned int RingIndex::getLowerBound(double x) const {
+    unsigned int low = 0;
+    unsigned int high = entries.size();
+    unsigned int middle;
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (entries[middle].x < x)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+void RingIndex::insert(double x, int member) {
+    Entry entry;
+
+    entry.x = x;
+    entry.member = member;
+    entries.insert(entries.begin() + getLowerBound(x), entry);
+}
+
+void RingIndex::remove(double x, int member) {
+    unsigned int i;
+
+    /* members sharing a position are next to each other */
+    for (i=getLowerBound(x); i<entries.size() && entries[i].x == x; i++) {
+        if (entries[i].member == member) {
+            entries.erase(entries.begin() + i);
+            return;
+        }
+    }
+}
+
+/* segments wrap around 0: points after the last member are managed by the first one */
+int RingIndex::getManager(double p) const {
+    unsigned int i;
+
+    if (entries.empty())
+        return -1;
+
+    i = getLowerBound(p);
+    if (i == entries.size())
+        i = 0;
+
+    return entries[i].member;
+}
@@ -0,0 +1,34 @@
+#ifndef _RINGINDEX_H_
+#define _RINGINDEX_H_
+
+#include <vector>
+
+/* positions of the members in the ring, kept sorted by position on the unit interval.
+ * The manager of a point is the first member at or after it going clockwise, so that
+ * it is found by binary search. Members join and leave through insert() and remove(),
+ * which shift the entries after them: a cheap move of a flat array even at 100k members
+ */
+class RingIndex
+{
+  private:
+    struct Entry {
+        double x;
+        int member;
+    };
+
+    std::vector<Entry> entries;
+
+    /* returns the index of the first entry at or after position x, entries.size() if none */
+    unsigned int getLowerBound(double x) const;
+
+  public:
+    void insert(double x, int member);
+    /* drops the entry of the member at position x, if any */
+    void remove(double x, int member);
+    /* returns the index of the manager of point p, -1 if the ring is empty */
+    int getManager(double p) const;
+    void clear() {entries.clear();}
+    unsigned int size() const {return entries.size();}
+};
+
+#endif // _RINGINDEX_H_
@@ -0,0 +1,69 @@
+#include "routingoracle.h"
+
+RoutingOracle::RoutingOracle() {
+    enabled = false;
+    clear();
+}
+
+void RoutingOracle::configure(bool enabled) {
+    this->enabled = enabled;
+}
+
+void RoutingOracle::clear() {
+    ring.clear();
+    managerDecisions = 0;
+    staleSegmentErrors = 0;
+    lookupsChecked = 0;
+    misroutedLookups = 0;
+    stretchedLookups = 0;
+    stretchSum = 0;
+    stretchMax = 0;
+}
+
+void RoutingOracle::managerDecision(double p, int member, bool claimed) {
+    if (!enabled)
+        return;
+
+    managerDecisions++;
+    if (claimed != (ring.getManager(p) == member))
+        staleSegmentErrors++;
+}
+
+double RoutingOracle::lookupCompleted(double p, int manager, int hops, int optimalHops) {
+    double stretch;
+
+    if (!enabled)
+        return 0;
+
+    lookupsChecked++;
+    if (ring.getManager(p) != manager)
+        misroutedLookups++;
+
+    /* lookups the origin answers by itself have no path to stretch */
+    if (optimalHops <= 0)
+        return 0;
+
+    stretch = (double)hops / optimalHops;
+    stretchedLookups++;
+    stretchSum += stretch;
+    if (stretch > stretchMax)
+        stretchMax = stretch;
+
+    return stretch;
+}
+
+void RoutingOracle::record(cModule* recorder) {
+    if (!enabled)
+        return;
+
+    recorder->recordScalar("#oracleManagerDecisions", managerDecisions);
+    recorder->recordScalar("#oracleStaleSegmentErrors", staleSegmentErrors);
+    recorder->recordScalar("#oracleLookupsChecked", lookupsChecked);
+    recorder->recordScalar("#oracleMisroutedLookups", misroutedLookups);
+    if (lookupsChecked > 0)
+        recorder->recordScalar("#oracleMisroutedRatio", (double)misroutedLookups / lookupsChecked);
+    if (stretchedLookups > 0) {
+        recorder->recordScalar("#oraclePathStretchMean", stretchSum / stretchedLookups);
+        recorder->recordScalar("#oraclePathStretchMax", stretchMax);
+    }
+}
@@ -0,0 +1,66 @@
+#include "eventqueue.h"
+
+EventQueue::EventQueue() {
+    nextSequence = 0;
+}
+
+bool EventQueue::firesBefore(const Event& a, const Event& b) {
+    if (a.time != b.time)
+        return a.time < b.time;
+    return a.sequence < b.sequence;
+}
+
+void EventQueue::siftUp(unsigned int i) {
+    unsigned int parent;
+    Event event = heap[i];
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!firesBefore(event, heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = event;
+}
+
+void EventQueue::siftDown(unsigned int i) {
+    unsigned int child;
+    unsigned int size = heap.size();
+    Event event = heap[i];
+
+    while ((child = 2 * i + 1) < size) {
+        if (child + 1 < size && firesBefore(heap[child + 1], heap[child]))
+            child++;
+        if (!firesBefore(heap[child], event))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = event;
+}
+
+void EventQueue::schedule(double time, int type, int node, int arg, double value) {
+    Event event;
+
+    event.time = time;
+    event.sequence = nextSequence++;
+    event.type = type;
+    event.node = node;
+    event.arg = arg;
+    event.value = value;
+
+    heap.push_back(event);
+    siftUp(heap.size() - 1);
+}
+
+Event EventQueue::pop() {
+    Event event = heap[0];
+
+    heap[0] = heap.back();
+    heap.pop_back();
+    if (!heap.empty())
+        siftDown(0);
+
+    return event;
+}
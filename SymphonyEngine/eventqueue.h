@@ -0,0 +1,50 @@
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+#include <vector>
+
+/* one future event of the engine
+ *
+ * time: simulation time the event fires at
+ * sequence: insertion order, events firing at the same time fire in that order
+ * type: one of the EVENT_* types of SymphonyEngine
+ * node: node the event happens at
+ * arg: lookup the event belongs to, or -1
+ * value: number carried by the event, such as an estimate
+ */
+struct Event {
+    double time;
+    unsigned long sequence;
+    int type;
+    int node;
+    int arg;
+    double value;
+};
+
+/* future event set of the engine, a binary min-heap ordered by time and then by
+ * insertion order, so that events scheduled for the same time fire first in first out
+ * as they do in omnet++
+ */
+class EventQueue
+{
+  private:
+    std::vector<Event> heap;
+    unsigned long nextSequence;
+
+    static bool firesBefore(const Event& a, const Event& b);
+    void siftUp(unsigned int i);
+    void siftDown(unsigned int i);
+
+  public:
+    EventQueue();
+
+    void schedule(double time, int type, int node, int arg=-1, double value=0);
+    /* removes and returns the next event, the queue must not be empty */
+    Event pop();
+    const Event& top() const {return heap[0];}
+    bool empty() const {return heap.empty();}
+    unsigned long size() const {return heap.size();}
+    void reserve(unsigned long events) {heap.reserve(events);}
+};
+
+#endif // _EVENTQUEUE_H_
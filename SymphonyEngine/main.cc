@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symphonyengine.h"
+
+/* runs the standalone symphony engine. Parameters are given as name=value pairs
+ * named after the parameters of omnetpp.ini, e.g.
+ *
+ *     symphonyengine DHTSize=1000000 connected=64 K=3 accessRate=10..20 \
+ *                    routingDirection=bidirectional longLinks=relative lookupRate=0.01
+ *
+ * and results are printed as one scalar for each line
+ */
+
+static void usage(const char* program) {
+    fprintf(stderr, "usage: %s [name=value ...]\n", program);
+    fprintf(stderr, "  DHTSize=<nodes>                    nodes in the simulation (128)\n");
+    fprintf(stderr, "  connected=<nodes>                  nodes in the initial ring (64)\n");
+    fprintf(stderr, "  K=<links>                          long links of every node (3)\n");
+    fprintf(stderr, "  accessRate=<s>|<min>..<max>        join delay after joinInterval * (i + 1) (10..20)\n");
+    fprintf(stderr, "  joinInterval=<s>                   time between consecutive joins (100)\n");
+    fprintf(stderr, "  linkDelay=<s>                      delay of every link (0.1)\n");
+    fprintf(stderr, "  routingDirection=clockwise|bidirectional\n");
+    fprintf(stderr, "  routing=greedy|lookahead\n");
+    fprintf(stderr, "  longLinks=absolute|relative        harmonic distance from 0, as DHTMember, or from the node\n");
+    fprintf(stderr, "  relinkMode=full|incremental        relinks drop every long link or only the implausible ones\n");
+    fprintf(stderr, "  lookupRate=<1/s>                   lookups started by random nodes (0)\n");
+    fprintf(stderr, "  sim-time-limit=<s>                 end of the run, 0 for the end of the joins (0)\n");
+    fprintf(stderr, "  seed=<n>                           seed of the random number generator (1)\n");
+    exit(1);
+}
+
+/* sets the parameter taken in input in config, returns false if it is unknown or malformed */
+static bool setParameter(EngineConfig& config, const char* name, const char* value) {
+    const char* range;
+
+    if (strcmp(name, "DHTSize") == 0)
+        config.DHTSize = atol(value);
+    else if (strcmp(name, "connected") == 0)
+        config.connected = atol(value);
+    else if (strcmp(name, "K") == 0)
+        config.K = atoi(value);
+    else if (strcmp(name, "accessRate") == 0) {
+        /* a range stands for intuniform(min, max) in omnetpp.ini */
+        range = strstr(value, "..");
+        config.accessRateMin = atol(value);
+        config.accessRateMax = range != NULL ? atol(range + 2) : config.accessRateMin;
+    } else if (strcmp(name, "joinInterval") == 0)
+        config.joinInterval = atof(value);
+    else if (strcmp(name, "linkDelay") == 0)
+        config.linkDelay = atof(value);
+    else if (strcmp(name, "routingDirection") == 0) {
+        if (strcmp(value, "clockwise") != 0 && strcmp(value, "bidirectional") != 0)
+            return false;
+        config.bidirectional = strcmp(value, "bidirectional") == 0;
+    } else if (strcmp(name, "routing") == 0) {
+        if (strcmp(value, "greedy") != 0 && strcmp(value, "lookahead") != 0)
+            return false;
+        config.lookahead = strcmp(value, "lookahead") == 0;
+    } else if (strcmp(name, "longLinks") == 0) {
+        if (strcmp(value, "absolute") != 0 && strcmp(value, "relative") != 0)
+            return false;
+        config.relativeLongLinks = strcmp(value, "relative") == 0;
+    } else if (strcmp(name, "relinkMode") == 0) {
+        if (strcmp(value, "full") != 0 && strcmp(value, "incremental") != 0)
+            return false;
+        config.incrementalRelink = strcmp(value, "incremental") == 0;
+    } else if (strcmp(name, "lookupRate") == 0)
+        config.lookupRate = atof(value);
+    else if (strcmp(name, "sim-time-limit") == 0)
+        config.simTimeLimit = atof(value);
+    else if (strcmp(name, "seed") == 0)
+        config.seed = strtoul(value, NULL, 10);
+    else
+        return false;
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int i;
+    char* separator;
+    EngineConfig config;
+
+    for (i=1; i<argc; i++) {
+        separator = strchr(argv[i], '=');
+        if (separator == NULL)
+            usage(argv[0]);
+
+        *separator = '\0';
+        if (!setParameter(config, argv[i], separator + 1)) {
+            fprintf(stderr, "%s: unknown parameter or value %s=%s\n", argv[0], argv[i], separator + 1);
+            usage(argv[0]);
+        }
+    }
+
+    if (config.connected < 16 || config.connected > config.DHTSize || config.K < 1 || config.K > MAX_K || config.accessRateMax < config.accessRateMin) {
+        fprintf(stderr, "%s: expected 16 <= connected <= DHTSize, 1 <= K <= %d and a valid accessRate\n", argv[0], MAX_K);
+        usage(argv[0]);
+    }
+
+    SymphonyEngine engine(config);
+    engine.run();
+    engine.printResults();
+
+    return 0;
+}
@@ -0,0 +1,659 @@
+#include <stdio.h>
+#include <math.h>
+#include "symphonyengine.h"
+#include "symphonyrouting.h"
+
+/* the protocol a node is running when it is running none */
+#define NONE -1
+
+/* length of a long link the node did not draw, drawn lengths lie in (0, 1] */
+#define LENGTH_UNKNOWN -1.0
+
+const char* SymphonyEngine::lookupProtocolNames[LOOKUP_PROTOCOLS_NUMBER] = {
+    "relink",
+    "join",
+    "lookup"
+};
+
+const char* SymphonyEngine::phaseNames[PHASES_NUMBER] = {
+    "estimation",
+    "lookup",
+    "membership"
+};
+
+/* defaults are those of package.ned and of the SymphonyDHT config of omnetpp.ini */
+EngineConfig::EngineConfig() {
+    DHTSize = 128;
+    connected = 64;
+    K = 3;
+    accessRateMin = 10;
+    accessRateMax = 20;
+    joinInterval = 100;
+    linkDelay = 0.1;
+    bidirectional = false;
+    lookahead = false;
+    relativeLongLinks = false;
+    incrementalRelink = false;
+    lookupRate = 0;
+    simTimeLimit = 0;
+    settleTime = 1000;
+    seed = 1;
+}
+
+/* the ring starts as SimphonyDHTNetwork in package.ned: connected nodes evenly spaced
+ * on the unit interval, short links between consecutive ones and K long links from
+ * node i to nodes i + 8 .. i + K + 7. The other nodes join one by one
+ */
+SymphonyEngine::SymphonyEngine(const EngineConfig& config) {
+    int i;
+    int j;
+    long node;
+
+    this->config = config;
+    now = 0;
+    randomState = config.seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    if (randomState == 0)
+        randomState = 1;
+
+    x.assign(config.DHTSize, 0);
+    nEstimate.assign(config.DHTSize, (int)config.connected);
+    nEstimateAtLinking.assign(config.DHTSize, (int)config.connected);
+    runningProtocol.assign(config.DHTSize, NONE);
+    relinkLookupsPending.assign(config.DHTSize, 0);
+    networkNodes.reserve(config.DHTSize);
+
+    slots = 2 + 2 * config.K;
+    links.assign((long)config.DHTSize * slots, -1);
+    reverseSlots.assign((long)config.DHTSize * slots, -1);
+    linksNumber.assign(config.DHTSize, 0);
+    linkLengths.assign((long)config.DHTSize * slots, LENGTH_UNKNOWN);
+    retiring.assign((long)config.DHTSize * slots, 0);
+
+    for (i=0; i<PHASES_NUMBER; i++)
+        packetsSent[i] = 0;
+    for (i=0; i<LOOKUP_PROTOCOLS_NUMBER; i++) {
+        lookupsCompleted[i] = 0;
+        lookupsLost[i] = 0;
+        lookupHopsSum[i] = 0;
+        lookupHopsMax[i] = 0;
+        lookupLatencySum[i] = 0;
+        lookupLatencyMax[i] = 0;
+    }
+    longLinksRefused = 0;
+    relinks = 0;
+    relinksCompleted = 0;
+    relinkLinksKept = 0;
+    eventsProcessed = 0;
+
+    for (node=0; node<config.connected; node++) {
+        x[node] = node / (double)config.connected;
+        networkNodes.push_back(node);
+    }
+
+    /* short links */
+    for (node=0; node<config.connected; node++)
+        connectSlot(node, 1, (node + 1) % config.connected, 0);
+
+    /* long links */
+    for (node=0; node<config.connected; node++) {
+        for (j=0; j<config.K; j++) {
+            if (node + j + 8 < config.connected)
+                connectSlot(node, getFirstFreeSlot(node), node + j + 8, getFirstFreeSlot(node + j + 8));
+        }
+    }
+
+    /* every node not in the ring will enter it sooner or later */
+    events.reserve(config.DHTSize - config.connected + 1024);
+    for (node=config.connected; node<config.DHTSize; node++)
+        events.schedule(config.joinInterval * (node + 1) + intuniform(config.accessRateMin, config.accessRateMax), EVENT_JOIN, node);
+
+    if (config.lookupRate > 0)
+        events.schedule(exponential(1 / config.lookupRate), EVENT_WORKLOAD_LOOKUP, -1);
+
+    if (config.simTimeLimit > 0)
+        endTime = config.simTimeLimit;
+    else if (config.DHTSize > config.connected)
+        endTime = config.joinInterval * config.DHTSize + config.accessRateMax + config.settleTime;
+    else
+        endTime = config.settleTime;
+}
+
+/* ===========================================
+ * |         random number generation        |
+ * ===========================================
+ */
+
+/* xorshift64*, a sample in [0, 1) */
+double SymphonyEngine::uniform() {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return ((randomState * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* an integer in [a, b] */
+long SymphonyEngine::intuniform(long a, long b) {
+    return a + (long)(uniform() * (b - a + 1));
+}
+
+double SymphonyEngine::exponential(double mean) {
+    return -mean * log(1 - uniform());
+}
+
+/* ===========================================
+ * |               simulation                |
+ * ===========================================
+ */
+
+void SymphonyEngine::run() {
+    Event event;
+
+    while (!events.empty() && events.top().time <= endTime) {
+        event = events.pop();
+        now = event.time;
+        eventsProcessed++;
+
+        switch (event.type) {
+        case EVENT_JOIN:
+            handleJoin(event.node);
+            break;
+        case EVENT_LOOKUP_HOP:
+            handleLookupHop(event.arg);
+            break;
+        case EVENT_LOOKUP_ANSWER:
+            handleLookupAnswer(event.arg);
+            break;
+        case EVENT_ESTIMATE:
+            handleEstimate(event.node);
+            break;
+        case EVENT_ESTIMATE_UPDATE:
+            handleEstimateUpdate(event.node, event.value);
+            break;
+        case EVENT_WORKLOAD_LOOKUP:
+            handleWorkloadLookup();
+            break;
+        }
+    }
+}
+
+void SymphonyEngine::printResults() {
+    int i;
+    long totalPacketsSent = 0;
+    long totalLinks = 0;
+    long node;
+
+    for (node=0; node<config.DHTSize; node++)
+        totalLinks += linksNumber[node];
+
+    printf("simTime %g\n", now);
+    printf("events %lu\n", eventsProcessed);
+    printf("#networkNodes %lu\n", (unsigned long)networkNodes.size());
+    printf("#meanLinksPerNode %g\n", networkNodes.empty() ? 0 : (double)totalLinks / networkNodes.size());
+    printf("#longLinksRefused %ld\n", longLinksRefused);
+    printf("#networkRelinks %ld\n", relinks);
+    printf("#networkRelinksCompleted %ld\n", relinksCompleted);
+    printf("#networkRelinkLinksKept %ld\n", relinkLinksKept);
+    for (i=0; i<PHASES_NUMBER; i++) {
+        printf("#networkPacketsSent:%s %ld\n", phaseNames[i], packetsSent[i]);
+        totalPacketsSent += packetsSent[i];
+    }
+    printf("#networkPacketsSent %ld\n", totalPacketsSent);
+    for (i=0; i<LOOKUP_PROTOCOLS_NUMBER; i++) {
+        printf("#networkLookups:%s %ld\n", lookupProtocolNames[i], lookupsCompleted[i]);
+        printf("#networkLookupsLost:%s %ld\n", lookupProtocolNames[i], lookupsLost[i]);
+        if (lookupsCompleted[i] == 0)
+            continue;
+        printf("%sLookupHops:mean %g\n", lookupProtocolNames[i], lookupHopsSum[i] / lookupsCompleted[i]);
+        printf("%sLookupHops:max %ld\n", lookupProtocolNames[i], lookupHopsMax[i]);
+        printf("%sLookupLatency:mean %g\n", lookupProtocolNames[i], lookupLatencySum[i] / lookupsCompleted[i]);
+        printf("%sLookupLatency:max %g\n", lookupProtocolNames[i], lookupLatencyMax[i]);
+    }
+}
+
+/* ===========================================
+ * |                 routing                 |
+ * ===========================================
+ */
+
+/* the segment of a node is computed from the position of its previous node, which
+ * DHTMember learns from the setup of their link
+ */
+double SymphonyEngine::getSegmentLength(int node) {
+    return SymphonyRouting::getSegmentLength(x[getPrevious(node)], x[node]);
+}
+
+/* returns the slot of the neighbour a lookup for the point taken in input is forwarded
+ * to, as getClosestNeighbourIndex() of DHTMember or, in lookahead mode, as
+ * getBestNeighbourIndex() of its SymphonyDHTMod variant. Returns -1 if node has no links
+ */
+int SymphonyEngine::getBestNeighbourSlot(int node, double point) {
+    int i;
+    int j;
+    int neighbour;
+    int second;
+    int bestSlot = -1;
+    double distanceDeltaToPoint;
+    double neighbourDistance;
+    double lookaheadDistance;
+    double bestDistance = 42; /* note: every number >= than 1 could be considered +infinity */
+    double bestNeighbourDistance = 42;
+
+    for (i=0; i<slots; i++) {
+        neighbour = link(node, i);
+        if (neighbour < 0)
+            continue;
+
+        neighbourDistance = SymphonyRouting::getDistanceToPoint(x[neighbour], point, config.bidirectional);
+        distanceDeltaToPoint = neighbourDistance;
+
+        if (config.lookahead) {
+            /* current node is in every list, it is not a valid second hop */
+            for (j=0; j<slots; j++) {
+                second = link(neighbour, j);
+                if (second < 0 || second == node)
+                    continue;
+
+                lookaheadDistance = SymphonyRouting::getDistanceToPoint(x[second], point, config.bidirectional);
+                if (lookaheadDistance < distanceDeltaToPoint)
+                    distanceDeltaToPoint = lookaheadDistance;
+            }
+        }
+
+        /* neighbours reaching the same node tie, the closest one of them goes on,
+         * otherwise two of them could hand the lookup back and forth
+         */
+        if (distanceDeltaToPoint < bestDistance || (distanceDeltaToPoint == bestDistance && neighbourDistance < bestNeighbourDistance)) {
+            bestDistance = distanceDeltaToPoint;
+            bestNeighbourDistance = neighbourDistance;
+            bestSlot = i;
+        }
+    }
+
+    if (bestSlot >= 0 && SymphonyRouting::successorIsManager(bestDistance, x[node], point, config.bidirectional))
+        bestSlot = 1;
+
+    return bestSlot;
+}
+
+/* ===========================================
+ * |                  links                  |
+ * ===========================================
+ */
+
+/* links slot of node to memberSlot of member in both directions. As DHTMember, the
+ * link setup carries the positions of both ends and costs no packet of its own
+ */
+void SymphonyEngine::connectSlot(int node, int slot, int member, int memberSlot) {
+    link(node, slot) = member;
+    reverseSlots[(long)node * slots + slot] = memberSlot;
+    linkLengths[(long)node * slots + slot] = LENGTH_UNKNOWN;
+    retiring[(long)node * slots + slot] = 0;
+    linksNumber[node]++;
+
+    link(member, memberSlot) = node;
+    reverseSlots[(long)member * slots + memberSlot] = slot;
+    linkLengths[(long)member * slots + memberSlot] = LENGTH_UNKNOWN;
+    retiring[(long)member * slots + memberSlot] = 0;
+    linksNumber[member]++;
+}
+
+void SymphonyEngine::disconnectSlot(int node, int slot) {
+    int member = link(node, slot);
+    int memberSlot = reverseSlots[(long)node * slots + slot];
+
+    link(member, memberSlot) = -1;
+    retiring[(long)member * slots + memberSlot] = 0;
+    linksNumber[member]--;
+    link(node, slot) = -1;
+    retiring[(long)node * slots + slot] = 0;
+    linksNumber[node]--;
+}
+
+/* returns the first free slot of node, -1 if every slot is in use */
+int SymphonyEngine::getFirstFreeSlot(int node) {
+    int i;
+    for (i=0; i<slots; i++) {
+        if (link(node, i) < 0)
+            return i;
+    }
+    return -1;
+}
+
+/* returns the last long link slot of node in use, -1 if none. As
+ * getLastConnectedGateIndex() of DHTMember, the first long link slot is never returned
+ */
+int SymphonyEngine::getLastLongLinkSlot(int node) {
+    int i;
+    for (i=slots-1; i>2; i--) {
+        if (link(node, i) >= 0)
+            return i;
+    }
+    return -1;
+}
+
+/* returns the first retiring long link slot of node, -1 if none */
+int SymphonyEngine::getRetiringSlot(int node) {
+    int i;
+    for (i=2; i<slots; i++) {
+        if (link(node, i) >= 0 && retiring[(long)node * slots + i])
+            return i;
+    }
+    return -1;
+}
+
+bool SymphonyEngine::alreadyConnected(int node, int member) {
+    int i;
+    for (i=0; i<slots; i++) {
+        if (link(node, i) == member)
+            return true;
+    }
+    return false;
+}
+
+void SymphonyEngine::dropAllLongLinks(int node) {
+    int i;
+    for (i=2; i<slots; i++) {
+        if (link(node, i) >= 0)
+            disconnectSlot(node, i);
+    }
+}
+
+/* creates a long link of the length taken in input from node to member, as
+ * createLongLinkToMember() of DHTMember. No link is created if member is node itself,
+ * they are already linked or member has no free slot. A retiring long link is swapped
+ * for the new one, otherwise once node has 2 + K links its last long link is replaced
+ */
+void SymphonyEngine::createLongLinkToMember(int node, int member, double length) {
+    int slot;
+
+    if (member == node || linksNumber[member] >= slots || alreadyConnected(node, member)) {
+        longLinksRefused++;
+        return;
+    }
+
+    slot = getRetiringSlot(node);
+    if (slot >= 0) {
+        disconnectSlot(node, slot);
+        connectSlot(node, slot, member, getFirstFreeSlot(member));
+    } else if (linksNumber[node] < 2 + config.K) {
+        slot = getFirstFreeSlot(node);
+        connectSlot(node, slot, member, getFirstFreeSlot(member));
+    } else {
+        slot = getLastLongLinkSlot(node);
+        if (slot < 0) {
+            longLinksRefused++;
+            return;
+        }
+        disconnectSlot(node, slot);
+        connectSlot(node, slot, member, getFirstFreeSlot(member));
+    }
+
+    linkLengths[(long)node * slots + slot] = length;
+}
+
+/* puts the joining node between manager and its previous node, as
+ * addNodeWithSpecificIntervalPosition() of DHTMember
+ */
+void SymphonyEngine::addNode(int joiningNode, int manager) {
+    int previous = getPrevious(manager);
+
+    disconnectSlot(manager, 0);
+    connectSlot(joiningNode, 0, previous, 1);
+    connectSlot(manager, 0, joiningNode, 1);
+
+    networkNodes.push_back(joiningNode);
+}
+
+/* ===========================================
+ * |                protocols                |
+ * ===========================================
+ */
+
+/* returns the index of a free entry of the lookup table */
+int SymphonyEngine::newLookup() {
+    int lookupIndex;
+
+    if (freeLookups.empty()) {
+        lookups.push_back(Lookup());
+        return lookups.size() - 1;
+    }
+
+    lookupIndex = freeLookups.back();
+    freeLookups.pop_back();
+    return lookupIndex;
+}
+
+/* origin starts a lookup for the manager of point, as routingProtocol() of DHTMember.
+ * The lookup is handled by origin itself as soon as current event is over. Returns the
+ * index of the lookup
+ */
+int SymphonyEngine::startLookup(int origin, double point, int protocol, int joiningNode) {
+    int lookupIndex = newLookup();
+    Lookup& lookup = lookups[lookupIndex];
+
+    lookup.origin = origin;
+    lookup.current = origin;
+    lookup.point = point;
+    lookup.protocol = protocol;
+    lookup.hops = 0;
+    lookup.start = now;
+    lookup.joiningNode = joiningNode;
+    lookup.manager = -1;
+    lookup.length = LENGTH_UNKNOWN;
+
+    /* workload lookups leave the running protocol untouched, as puts and gets */
+    if (protocol != LOOKUP)
+        runningProtocol[origin] = protocol;
+
+    events.schedule(now, EVENT_LOOKUP_HOP, origin, lookupIndex);
+    return lookupIndex;
+}
+
+/* node asks its neighbours for their segment lengths, which they keep up to date and
+ * send back at once. Packets are those DHTMember sends: two segment length requests,
+ * as many replies and two estimate updates
+ */
+void SymphonyEngine::calculateNEstimate(int node) {
+    packetsSent[PHASE_ESTIMATION] += 6;
+    events.schedule(now + 2 * config.linkDelay, EVENT_ESTIMATE, node);
+}
+
+/* node drops its long links and looks up K new ones, as relink() of DHTMember. In
+ * incremental mode the long links node drew that are still harmonic samples for its
+ * new estimate are kept and the others retire once their replacements are linked
+ */
+void SymphonyEngine::relink(int node) {
+    int i;
+    int lookupsNumber;
+    int linksKept = 0;
+    int grownLookups = 0;
+    bool drawnLinks = false;
+    long slot;
+    double length;
+    double point;
+    double previousEstimate;
+
+    /* links of a relink still running are already being replaced */
+    if (relinkLookupsPending[node] > 0)
+        return;
+
+    previousEstimate = nEstimateAtLinking[node];
+    nEstimateAtLinking[node] = nEstimate[node];
+
+    for (i=2; i<slots; i++) {
+        slot = (long)node * slots + i;
+        if (link(node, i) >= 0 && linkLengths[slot] != LENGTH_UNKNOWN)
+            drawnLinks = true;
+    }
+
+    if (config.incrementalRelink && drawnLinks) {
+        for (i=2; i<slots; i++) {
+            slot = (long)node * slots + i;
+            retiring[slot] = 0;
+            if (link(node, i) < 0 || linkLengths[slot] == LENGTH_UNKNOWN)
+                continue;
+
+            if (SymphonyRouting::isHarmonicSample(linkLengths[slot], nEstimate[node], previousEstimate, uniform())) {
+                linksKept++;
+            } else {
+                retiring[slot] = 1;
+                if (nEstimate[node] > previousEstimate)
+                    grownLookups++;
+            }
+        }
+        lookupsNumber = config.K - linksKept;
+    } else {
+        dropAllLongLinks(node);
+        lookupsNumber = config.K;
+    }
+
+    relinks++;
+    relinkLinksKept += linksKept;
+    relinkLookupsPending[node] = lookupsNumber;
+
+    /* every drawn link was kept, the relink is complete at once */
+    if (lookupsNumber == 0)
+        relinksCompleted++;
+
+    for (i=0; i<lookupsNumber; i++) {
+        if (i < grownLookups)
+            length = SymphonyRouting::getGrownHarmonicDistance(nEstimate[node], previousEstimate, uniform());
+        else
+            length = SymphonyRouting::getHarmonicDistance(nEstimate[node], uniform());
+        point = length;
+        if (config.relativeLongLinks)
+            point = fmod(x[node] + point, 1.0);
+        lookups[startLookup(node, point, RELINK, -1)].length = length;
+    }
+}
+
+/* one of the lookups of the running relink of node got its answer or was lost,
+ * as relinkLookupCompleted() of DHTMember
+ */
+void SymphonyEngine::relinkLookupCompleted(int node) {
+    relinkLookupsPending[node]--;
+    if (relinkLookupsPending[node] == 0)
+        relinksCompleted++;
+}
+
+/* ===========================================
+ * |             event handlers              |
+ * ===========================================
+ */
+
+/* node picks a position and asks a node of the initial ring to look up its manager,
+ * as handleJoinNetwork() of DHTMember
+ */
+void SymphonyEngine::handleJoin(int node) {
+    double randx = uniform();
+    int randFriend = intuniform(0, config.connected - 1);
+
+    x[node] = randx;
+    runningProtocol[node] = JOIN;
+    startLookup(randFriend, randx, JOIN, node);
+}
+
+/* the lookup reached a node: it stops there if that node is the manager of its point,
+ * otherwise it goes on to the best neighbour, as handleManagerCheck() of DHTMember
+ */
+void SymphonyEngine::handleLookupHop(int lookupIndex) {
+    Lookup& lookup = lookups[lookupIndex];
+    int node = lookup.current;
+    int slot;
+
+    if (SymphonyRouting::isManagerOfPoint(x[node], getSegmentLength(node), lookup.point)) {
+        lookup.manager = node;
+        if (lookup.hops == 0) {
+            handleLookupAnswer(lookupIndex);
+        } else {
+            /* the answer goes back along the path of the lookup */
+            packetsSent[PHASE_LOOKUP] += lookup.hops;
+            events.schedule(now + lookup.hops * config.linkDelay, EVENT_LOOKUP_ANSWER, lookup.origin, lookupIndex);
+        }
+        return;
+    }
+
+    /* greedy routing never takes more hops than there are nodes, lookahead routing
+     * could go round in circles
+     */
+    slot = getBestNeighbourSlot(node, lookup.point);
+    if (slot < 0 || lookup.hops >= (long)networkNodes.size()) {
+        lookupsLost[lookup.protocol]++;
+        if (lookup.protocol == RELINK) {
+            relinkLookupCompleted(lookup.origin);
+        } else if (lookup.protocol == JOIN) {
+            /* the joining node tries again later, from another position, as
+             * lookupRejected() of DHTMember
+             */
+            events.schedule(now + exponential(10), EVENT_JOIN, lookup.joiningNode);
+        }
+        freeLookups.push_back(lookupIndex);
+        return;
+    }
+
+    lookup.current = link(node, slot);
+    lookup.hops++;
+    packetsSent[PHASE_LOOKUP]++;
+    events.schedule(now + config.linkDelay, EVENT_LOOKUP_HOP, lookup.current, lookupIndex);
+}
+
+/* the answer of a lookup came back to its origin, as handleManagerIndex() of DHTMember */
+void SymphonyEngine::handleLookupAnswer(int lookupIndex) {
+    Lookup& lookup = lookups[lookupIndex];
+    int protocol = lookup.protocol;
+    double latency = now - lookup.start;
+
+    lookupsCompleted[protocol]++;
+    lookupHopsSum[protocol] += lookup.hops;
+    if (lookup.hops > lookupHopsMax[protocol])
+        lookupHopsMax[protocol] = lookup.hops;
+    lookupLatencySum[protocol] += latency;
+    if (latency > lookupLatencyMax[protocol])
+        lookupLatencyMax[protocol] = latency;
+
+    if (protocol == RELINK) {
+        if (lookup.manager != lookup.origin)
+            createLongLinkToMember(lookup.origin, lookup.manager, lookup.length);
+        relinkLookupCompleted(lookup.origin);
+    } else if (protocol == JOIN) {
+        addNode(lookup.joiningNode, lookup.manager);
+        calculateNEstimate(lookup.joiningNode);
+    }
+
+    freeLookups.push_back(lookupIndex);
+}
+
+/* the segment lengths of node and of its neighbours are known, node updates its
+ * estimate and sends it to them, as handleSegmentLengthReply() of DHTMember
+ */
+void SymphonyEngine::handleEstimate(int node) {
+    int previous = link(node, 0);
+    int next = link(node, 1);
+    double totalSegmentsLengths;
+
+    totalSegmentsLengths = getSegmentLength(previous) + getSegmentLength(node) + getSegmentLength(next);
+    nEstimate[node] = (int)SymphonyRouting::estimateNodes(totalSegmentsLengths, 3);
+
+    events.schedule(now + config.linkDelay, EVENT_ESTIMATE_UPDATE, previous, -1, nEstimate[node]);
+    events.schedule(now + config.linkDelay, EVENT_ESTIMATE_UPDATE, next, -1, nEstimate[node]);
+
+    /* start relink procedure on nEstimate update after join */
+    if (runningProtocol[node] == JOIN)
+        relink(node);
+}
+
+/* a neighbour sent its estimate, as handleEstimateUpdate() of DHTMember */
+void SymphonyEngine::handleEstimateUpdate(int node, double estimate) {
+    nEstimate[node] = estimate;
+
+    if (SymphonyRouting::needToRelink(nEstimate[node], nEstimateAtLinking[node]))
+        relink(node);
+}
+
+/* a random node of the ring looks up the manager of a random point */
+void SymphonyEngine::handleWorkloadLookup() {
+    int origin = networkNodes[intuniform(0, networkNodes.size() - 1)];
+
+    startLookup(origin, uniform(), LOOKUP, -1);
+    events.schedule(now + exponential(1 / config.lookupRate), EVENT_WORKLOAD_LOOKUP, -1);
+}
@@ -0,0 +1,220 @@
+#ifndef _SYMPHONYENGINE_H_
+#define _SYMPHONYENGINE_H_
+
+#include <vector>
+#include <limits.h>
+#include <stdint.h>
+#include "eventqueue.h"
+
+/* protocols lookups are started for, RELINK and JOIN as in DHTMember. LOOKUP stands
+ * for the lookups of a storage workload, as puts and gets of DHTMember
+ */
+#define RELINK 0
+#define JOIN   1
+#define LOOKUP 2
+#define LOOKUP_PROTOCOLS_NUMBER 3
+
+/* protocol phases packets are accounted to, as in DHTMetrics */
+#define PHASE_ESTIMATION 0
+#define PHASE_LOOKUP     1
+#define PHASE_MEMBERSHIP 2
+#define PHASES_NUMBER    3
+
+/* the 2 + 2K link slots of a node are indexed by short integers */
+#define MAX_K ((SHRT_MAX - 2) / 2)
+
+/* parameters of a run, named after the parameters of SimphonyDHTNetwork and
+ * DHTMember they stand for
+ *
+ * DHTSize: nodes in the simulation
+ * connected: nodes in the ring when the simulation starts, the others join one by one
+ * K: long links created by every node, each node has 2 + 2K links at most, K <= MAX_K
+ * accessRateMin, accessRateMax: node i joins at joinInterval * (i + 1) plus an integer
+ *                               drawn uniformly in [accessRateMin, accessRateMax]
+ * joinInterval: time between the joins of consecutive nodes
+ * linkDelay: delay of every link
+ * bidirectional: lookups are routed both ways around the ring
+ * lookahead: lookups are routed to the neighbour whose own neighbours get closest
+ *            to the point, as the lookahead routing of SymphonyDHTMod
+ * relativeLongLinks: long links are drawn at a harmonic distance from the node.
+ *                    DHTMember draws their points at a harmonic distance from 0
+ * incrementalRelink: relinks keep the long links that are still harmonic samples for
+ *                    the new estimate, as the incremental relinkMode of DHTMember
+ * lookupRate: lookups per second started by random nodes of the ring, 0 for none
+ * simTimeLimit: time the run ends at, 0 to end settleTime after the last join
+ * settleTime: time given to the last join to complete
+ * seed: seed of the random number generator
+ */
+struct EngineConfig {
+    long DHTSize;
+    long connected;
+    int K;
+    long accessRateMin;
+    long accessRateMax;
+    double joinInterval;
+    double linkDelay;
+    bool bidirectional;
+    bool lookahead;
+    bool relativeLongLinks;
+    bool incrementalRelink;
+    double lookupRate;
+    double simTimeLimit;
+    double settleTime;
+    unsigned long seed;
+
+    EngineConfig();
+};
+
+/* standalone simulator of the symphony overlay, free of omnet++ so that millions of
+ * nodes fit in a single process. It reproduces the join, estimate, relink and lookup
+ * protocols of DHTMember, taking its routing decisions through SymphonyRouting.
+ * Node state is kept as a structure of arrays indexed by node, links as a flat array
+ * of 2 + 2K slots per node where slot 0 links the previous node, slot 1 the next one
+ * and the others long links, as the gates of DHTMember.
+ * Packets are not simulated one by one: a lookup fires one event per hop and its
+ * answer comes back in a single event after as many link delays, packets of every
+ * phase are counted as DHTMember would send them
+ */
+class SymphonyEngine
+{
+  private:
+    /* a lookup in flight
+     *
+     * origin: node that started the lookup and gets its answer
+     * current: node the lookup is at
+     * point: point whose manager is looked up
+     * protocol: protocol that started the lookup
+     * hops: hops taken so far
+     * start: time the lookup started
+     * joiningNode: node that joins next to the manager, for JOIN lookups
+     * manager: manager found, once the lookup reached it
+     * length: harmonic length drawn for the long link, for RELINK lookups
+     */
+    struct Lookup {
+        int origin;
+        int current;
+        double point;
+        int protocol;
+        int hops;
+        double start;
+        int joiningNode;
+        int manager;
+        double length;
+    };
+
+    /* event types */
+    enum {
+        EVENT_JOIN,
+        EVENT_LOOKUP_HOP,
+        EVENT_LOOKUP_ANSWER,
+        EVENT_ESTIMATE,
+        EVENT_ESTIMATE_UPDATE,
+        EVENT_WORKLOAD_LOOKUP
+    };
+
+    EngineConfig config;
+    EventQueue events;
+    double now;
+    double endTime;
+    uint64_t randomState;
+
+    /* node state, one entry for each node
+     *
+     * x: position on the unit interval
+     * nEstimate: estimate of the number of nodes in the network, whole as in DHTMember
+     * nEstimateAtLinking: estimate when long links were last created
+     * runningProtocol: protocol the node is running, JOIN until its first relink
+     * relinkLookupsPending: lookups of the running relink still waiting for an answer
+     * networkNodes: nodes in the ring
+     */
+    std::vector<double> x;
+    std::vector<int> nEstimate;
+    std::vector<int> nEstimateAtLinking;
+    std::vector<signed char> runningProtocol;
+    std::vector<int> relinkLookupsPending;
+    std::vector<int> networkNodes;
+
+    /* flat link table, slots entries for each node
+     *
+     * links: node linked through each slot, -1 if the slot is free
+     * reverseSlots: slot of that node linked back
+     * linksNumber: slots in use of each node
+     * linkLengths: harmonic length the node drew for the long link, LENGTH_UNKNOWN for
+     *              short links and for long links drawn by the other end
+     * retiring: the long link is swapped for the next one the node creates
+     */
+    int slots;
+    std::vector<int> links;
+    std::vector<short> reverseSlots;
+    std::vector<short> linksNumber;
+    std::vector<double> linkLengths;
+    std::vector<char> retiring;
+
+    /* lookups in flight, indexed by the arg of their events. Entries of completed
+     * lookups are reused
+     */
+    std::vector<Lookup> lookups;
+    std::vector<int> freeLookups;
+
+    /* metrics, named after the scalars of DHTMetrics */
+    long packetsSent[PHASES_NUMBER];
+    long lookupsCompleted[LOOKUP_PROTOCOLS_NUMBER];
+    long lookupsLost[LOOKUP_PROTOCOLS_NUMBER];
+    double lookupHopsSum[LOOKUP_PROTOCOLS_NUMBER];
+    long lookupHopsMax[LOOKUP_PROTOCOLS_NUMBER];
+    double lookupLatencySum[LOOKUP_PROTOCOLS_NUMBER];
+    double lookupLatencyMax[LOOKUP_PROTOCOLS_NUMBER];
+    long longLinksRefused;
+    long relinks;
+    long relinksCompleted;
+    long relinkLinksKept;
+    unsigned long eventsProcessed;
+
+    static const char* lookupProtocolNames[LOOKUP_PROTOCOLS_NUMBER];
+    static const char* phaseNames[PHASES_NUMBER];
+
+    double uniform();
+    long intuniform(long a, long b);
+    double exponential(double mean);
+
+    int& link(int node, int slot) {return links[(long)node * slots + slot];}
+    int getPrevious(int node) {return link(node, 0);}
+    double getSegmentLength(int node);
+    int getBestNeighbourSlot(int node, double point);
+
+    /* links */
+    void connectSlot(int node, int slot, int member, int memberSlot);
+    void disconnectSlot(int node, int slot);
+    int getFirstFreeSlot(int node);
+    int getLastLongLinkSlot(int node);
+    bool alreadyConnected(int node, int member);
+    int getRetiringSlot(int node);
+    void dropAllLongLinks(int node);
+    void createLongLinkToMember(int node, int member, double length);
+    void addNode(int joiningNode, int manager);
+
+    /* protocols */
+    int startLookup(int origin, double point, int protocol, int joiningNode);
+    int newLookup();
+    void calculateNEstimate(int node);
+    void relink(int node);
+    void relinkLookupCompleted(int node);
+
+    /* event handlers */
+    void handleJoin(int node);
+    void handleLookupHop(int lookupIndex);
+    void handleLookupAnswer(int lookupIndex);
+    void handleEstimate(int node);
+    void handleEstimateUpdate(int node, double estimate);
+    void handleWorkloadLookup();
+
+  public:
+    SymphonyEngine(const EngineConfig& config);
+
+    /* runs the simulation until simTimeLimit or until no event is left */
+    void run();
+    /* prints the metrics of the run, one scalar for each line */
+    void printResults();
+};
+
+#endif // _SYMPHONYENGINE_H_
@@ -0,0 +1,106 @@
+#ifndef _SYMPHONYROUTING_H_
+#define _SYMPHONYROUTING_H_
+
+#include <math.h>
+
+/* routing core of the symphony protocol, shared by DHTMember and by the standalone
+ * engine so that both take the same decisions. It knows nothing about modules, gates
+ * or packets: positions, segments and estimates are plain numbers on the unit interval
+ */
+class SymphonyRouting
+{
+  public:
+    /* returns the distance of the point taken in input from the position taken in input.
+     * Going clockwise only, the point is reached by its manager, the first node after it.
+     * Going both ways, it is the shortest way around the unit interval
+     */
+    static double getDistanceToPoint(double position, double point, bool bidirectional) {
+        double distanceDeltaToPoint = position - point;
+
+        if (distanceDeltaToPoint < 0)
+            distanceDeltaToPoint += 1;
+
+        if (bidirectional && distanceDeltaToPoint > 0.5)
+            distanceDeltaToPoint = 1 - distanceDeltaToPoint;
+
+        return distanceDeltaToPoint;
+    }
+
+    /* returns true if the node at position x, managing a segment of the length taken
+     * in input, is the manager of point p. The segment wraps around 0 when it is
+     * longer than x
+     */
+    static bool isManagerOfPoint(double x, double segmentLength, double p) {
+        double delta = x - segmentLength;
+
+        if (delta >= 0)
+            return p > delta && p <= x;
+        return p > 1 + delta || p <= x;
+    }
+
+    /* returns the length of the segment managed by the node at position x, given
+     * the position of its previous node
+     */
+    static double getSegmentLength(double previousX, double x) {
+        if (previousX < x)
+            return x - previousX;
+        return x + 1.0 - previousX;
+    }
+
+    /* returns the estimate of the number of nodes in the network, given the total
+     * length of the segments taken in input and how many they are
+     */
+    static double estimateNodes(double totalSegmentsLength, int segments) {
+        return segments / totalSegmentsLength;
+    }
+
+    /* returns true if the estimate changed enough since long links were created
+     * that they must be created again. Estimates are whole numbers of nodes and their
+     * ratio is an integer division: any shrink relinks, growth only from three times
+     */
+    static bool needToRelink(int nEstimate, int nEstimateAtLinking) {
+        double estimateRatio = nEstimate / nEstimateAtLinking;
+        return estimateRatio < 0.5 || estimateRatio > 2;
+    }
+
+    /* returns a length in [1/nEstimate, 1] drawn with the harmonic probability density
+     * function, u is a uniform sample in [0, 1)
+     */
+    static double getHarmonicDistance(double nEstimate, double u) {
+        return exp(log(nEstimate) * (u - 1.0));
+    }
+
+    /* returns true if a long link drawn by getHarmonicDistance() with the length taken in
+     * input, when the estimate was nEstimateAtLinking, can be kept as a sample for
+     * nEstimate. u is a uniform sample in [0, 1). Links shorter than 1/nEstimate lie out
+     * of the new distribution. A grown estimate also draws lengths in [1/nEstimate,
+     * 1/nEstimateAtLinking], then each link is kept with probability
+     * log(nEstimateAtLinking) / log(nEstimate) and otherwise replaced by a length drawn by
+     * getGrownHarmonicDistance(). Kept and replaced links together follow the harmonic
+     * distribution of nEstimate
+     */
+    static bool isHarmonicSample(double length, double nEstimate, double nEstimateAtLinking, double u) {
+        if (length < 1.0 / nEstimate)
+            return false;
+        if (nEstimate > nEstimateAtLinking)
+            return u < log(nEstimateAtLinking) / log(nEstimate);
+        return true;
+    }
+
+    /* returns a length in [1/nEstimate, 1/nEstimateAtLinking] drawn with the harmonic
+     * probability density function of nEstimate, u is a uniform sample in [0, 1)
+     */
+    static double getGrownHarmonicDistance(double nEstimate, double nEstimateAtLinking, double u) {
+        return getHarmonicDistance(nEstimate, u * (1.0 - log(nEstimateAtLinking) / log(nEstimate)));
+    }
+
+    /* returns true if no neighbour is closer to the point than the node at position x,
+     * given the distance of the closest one. Going both ways it means the node precedes
+     * the point, then its successor is the manager
+     */
+    static bool successorIsManager(double bestDistance, double x, double point, bool bidirectional) {
+        return bidirectional && bestDistance >= getDistanceToPoint(x, point, bidirectional);
+    }
+};
+
+#endif // _SYMPHONYROUTING_H_